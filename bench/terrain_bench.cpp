@@ -0,0 +1,1074 @@
+// Throughput benchmarks for the terrain library.
+//
+// Built as the terrain_bench target when Google Benchmark is found. Run with
+// JSON output for regression tracking:
+//   ./terrain_bench --benchmark_out=results.json --benchmark_out_format=json
+//
+// Dataset sizes go from 10^4 points up to TERRAIN_BENCH_MAX_POINTS (default
+// 10^6; raise it to 100000000 for the full 10^8 sweep on a large host). Each
+// run also reports allocation counts and the heap high-water mark through a
+// MemoryManager backed by the counting operator new below, and tree_bytes,
+// the live heap held by one fully built tree, split by memory_report() into
+// payload, structure and slack bytes.
+#include <benchmark/benchmark.h>
+#include <malloc.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "terrain/ingest.h"
+#include "terrain/join.h"
+#include "terrain/layout.h"
+#include "terrain/quadtree.h"
+#include "terrain/query_cache.h"
+#include "terrain/rle.h"
+#include "terrain/tile_pyramid.h"
+#include "terrain/visibility.h"
+#include "terrain_generators.h"
+
+namespace {
+
+std::atomic<long long> g_live(0);
+std::atomic<long long> g_peak(0);
+std::atomic<long long> g_allocs(0);
+std::atomic<long long> g_allocated(0);
+
+void note_alloc(long long bytes) {
+    long long live = g_live.fetch_add(bytes) + bytes;
+    long long peak = g_peak.load();
+    while (live > peak && !g_peak.compare_exchange_weak(peak, live)) {
+    }
+    g_allocs.fetch_add(1);
+    g_allocated.fetch_add(bytes);
+}
+
+class CountingMemoryManager : public benchmark::MemoryManager {
+public:
+    void Start() {
+        start_live = g_live.load();
+        g_peak.store(start_live);
+        g_allocs.store(0);
+        g_allocated.store(0);
+    }
+    void Stop(Result& result) {
+        result.num_allocs = g_allocs.load();
+        result.max_bytes_used = g_peak.load() - start_live;
+        result.total_allocated_bytes = g_allocated.load();
+        result.net_heap_growth = g_live.load() - start_live;
+    }
+    void Stop(Result* result) { Stop(*result); }
+private:
+    long long start_live = 0;
+};
+
+}  // namespace
+
+void* operator new(std::size_t n) {
+    void* p = std::malloc(n ? n : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    note_alloc(static_cast<long long>(malloc_usable_size(p)));
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (p != nullptr) {
+        g_live.fetch_sub(static_cast<long long>(malloc_usable_size(p)));
+        std::free(p);
+    }
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+namespace {
+
+using terrain_bench::Sample;
+
+enum Terrain { kUniform, kClustered, kFractal, kFlat };
+const char* const kTerrainNames[] = {"uniform", "clustered", "fractal", "flat"};
+
+// Inputs built on first use and kept for the whole run, one per distinct key,
+// so every benchmark and size shares them.
+template <class Key, class Value>
+class Memo {
+public:
+    template <class Make>
+    const Value& get(const Key& key, Make make) {
+        auto it = values.find(key);
+        if (it == values.end()) {
+            it = values.emplace(key, make()).first;
+        }
+        return it->second;
+    }
+private:
+    std::map<Key, Value> values;
+};
+
+const std::vector<Sample>& dataset(int terrain, std::size_t n) {
+    static Memo<std::pair<int, std::size_t>, std::vector<Sample>> memo;
+    return memo.get(std::make_pair(terrain, n), [&] {
+        if (terrain == kUniform) {
+            return terrain_bench::uniform_terrain(n);
+        } else if (terrain == kClustered) {
+            return terrain_bench::clustered_terrain(n);
+        } else if (terrain == kFlat) {
+            return terrain_bench::flat_terrain(n);
+        }
+        return terrain_bench::fractal_terrain(n);
+    });
+}
+
+long long max_points() {
+    const char* env = std::getenv("TERRAIN_BENCH_MAX_POINTS");
+    return env ? std::atoll(env) : 1000000;
+}
+
+void terrain_sizes(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"terrain", "n"});
+    for (int terrain = kUniform; terrain <= kFractal; terrain++) {
+        for (long long n = 10000; n <= max_points(); n *= 10) {
+            b->Args({terrain, n});
+        }
+    }
+}
+
+// terrain_sizes plus flat ground, where an error-driven split rule has no
+// reason to subdivide and leaf size is bounded only by its count cap.
+void query_sizes(benchmark::internal::Benchmark* b) {
+    terrain_sizes(b);
+    for (long long n = 10000; n <= max_points(); n *= 10) {
+        b->Args({kFlat, n});
+    }
+}
+
+// Uniform terrain only, for sweeps over a policy parameter.
+void uniform_sizes(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"terrain", "n"});
+    for (long long n = 10000; n <= max_points(); n *= 10) {
+        b->Args({kUniform, n});
+    }
+}
+
+// `count` square windows of the given half-extent, centres uniform over the
+// extent shrunk by `inset` on every side; the query benchmarks cycle through
+// them.
+template <class Rectangle>
+const std::vector<Rectangle>& windows(double half_extent, unsigned seed, int count, double inset = 0) {
+    static Memo<std::tuple<double, unsigned, int, double>, std::vector<Rectangle>> memo;
+    return memo.get(std::make_tuple(half_extent, seed, count, inset), [&] {
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<double> coord(terrain_bench::kMin + inset, terrain_bench::kMax - inset);
+        std::vector<Rectangle> out;
+        for (int i = 0; i < count; i++) {
+            out.push_back(Rectangle(coord(rng), coord(rng), half_extent, half_extent));
+        }
+        return out;
+    });
+}
+
+// Small windows scattered over the extent, the default query workload.
+template <class Rectangle>
+const std::vector<Rectangle>& small_windows() {
+    return windows<Rectangle>(2, 7, 1024);
+}
+
+typedef terrain::Quadtree<> CountTree;
+typedef terrain::Quadtree<terrain::AdaptivePolicy> AdaptiveTree;
+typedef terrain::Quadtree<terrain::InstrumentedPolicy> InstrumentedTree;
+template <std::size_t Capacity>
+using CapacityTree = terrain::Quadtree<terrain::QuadtreePolicy<double, double, Capacity, 16>>;
+
+template <class Tree>
+std::unique_ptr<Tree> make_tree() {
+    return std::unique_ptr<Tree>(new Tree(typename Tree::Rectangle(-100, -100, 200, 200)));
+}
+
+template <>
+std::unique_ptr<AdaptiveTree> make_tree<AdaptiveTree>() {
+    return std::unique_ptr<AdaptiveTree>(new AdaptiveTree(AdaptiveTree::Rectangle(-100, -100, 200, 200), 1.0));
+}
+
+template <class Tree>
+void fill(Tree& tree, const std::vector<Sample>& pts) {
+    for (auto& s : pts) {
+        tree.insert(typename Tree::Point(s.x, s.y, s.z));
+    }
+}
+
+void set_terrain(benchmark::State& state) {
+    state.SetLabel(kTerrainNames[state.range(0)]);
+}
+
+// Per-iteration hot-path counters, for trees built with CountingInstrumentation.
+template <class Tree>
+void report_counters(benchmark::State& state, const Tree& tree) {
+    if constexpr (Tree::Instrumentation::enabled) {
+        const terrain::QuadtreeCounters& c = tree.instrumentation().counters;
+        state.counters["nodes_visited"] = benchmark::Counter(static_cast<double>(c.nodes_visited), benchmark::Counter::kAvgIterations);
+        state.counters["leaves_scanned"] = benchmark::Counter(static_cast<double>(c.leaves_scanned), benchmark::Counter::kAvgIterations);
+        state.counters["points_tested"] = benchmark::Counter(static_cast<double>(c.points_tested), benchmark::Counter::kAvgIterations);
+    }
+}
+
+template <class Tree>
+void reset_counters(Tree& tree) {
+    if constexpr (Tree::Instrumentation::enabled) {
+        tree.instrumentation().reset();
+    }
+}
+
+template <class Tree>
+void BM_BulkBuild(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    for (auto _ : state) {
+        auto tree = make_tree<Tree>();
+        fill(*tree, pts);
+        benchmark::DoNotOptimize(tree.get());
+    }
+    long long before = g_live.load();
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    state.counters["tree_bytes"] = static_cast<double>(g_live.load() - before);
+    terrain::MemoryReport report = tree->memory_report();
+    state.counters["payload_bytes"] = static_cast<double>(report.payload_bytes);
+    state.counters["structure_bytes"] = static_cast<double>(report.structure_bytes);
+    state.counters["slack_bytes"] = static_cast<double>(report.slack_bytes);
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(pts.size()));
+    set_terrain(state);
+}
+
+// Cost of one more insert into a tree that already holds n points.
+template <class Tree>
+void BM_Insert(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    const auto& extra = dataset(state.range(0), 10000);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const Sample& s = extra[i++ % extra.size()];
+        tree->insert(typename Tree::Point(s.x, s.y, s.z));
+    }
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+template <class Tree>
+void BM_Query(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    const auto& ranges = small_windows<typename Tree::Rectangle>();
+    std::vector<typename Tree::Point> found;
+    std::size_t i = 0, hits = 0;
+    reset_counters(*tree);
+    for (auto _ : state) {
+        found.clear();
+        tree->query(ranges[i++ % ranges.size()], found);
+        hits += found.size();
+        benchmark::DoNotOptimize(found.data());
+    }
+    report_counters(state, *tree);
+    state.counters["found"] = benchmark::Counter(static_cast<double>(hits), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+template <class Tree>
+void BM_Intersect(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    const auto& ranges = small_windows<typename Tree::Rectangle>();
+    std::size_t i = 0, hits = 0;
+    for (auto _ : state) {
+        auto found = tree->intersect(ranges[i++ % ranges.size()]);
+        hits += found.size();
+        benchmark::DoNotOptimize(found.data());
+    }
+    state.counters["found"] = benchmark::Counter(static_cast<double>(hits), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+template <class Tree>
+void BM_Compress(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    std::size_t merged = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto tree = make_tree<Tree>();
+        fill(*tree, pts);
+        std::size_t before = tree->memory_report().nodes;
+        state.ResumeTiming();
+        tree->compress();
+        state.PauseTiming();
+        merged = before - tree->memory_report().nodes;
+        tree.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(pts.size()));
+    state.counters["merged_nodes"] = static_cast<double>(merged);
+    set_terrain(state);
+}
+
+// Inserts into a compressed tree, whose merged leaves already hold more than a
+// buffer's worth and split again on their next insert.
+template <class Tree>
+void BM_InsertAfterCompress(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    tree->compress();
+    const auto& extra = dataset(state.range(0), 10000);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const Sample& s = extra[i++ % extra.size()];
+        tree->insert(typename Tree::Point(s.x, s.y, s.z));
+    }
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+template <class Tree>
+void BM_IsSmooth(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    const auto& ranges = small_windows<typename Tree::Rectangle>();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        bool smooth = tree->is_smooth(ranges[i++ % ranges.size()], 3);
+        benchmark::DoNotOptimize(smooth);
+    }
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+// Random observer/target sample pairs for the visibility benchmarks.
+const std::vector<std::pair<Sample, Sample>>& sight_pairs(int terrain, std::size_t n) {
+    static Memo<std::pair<int, std::size_t>, std::vector<std::pair<Sample, Sample>>> memo;
+    return memo.get(std::make_pair(terrain, n), [&] {
+        const auto& pts = dataset(terrain, n);
+        std::mt19937_64 rng(11);
+        std::uniform_int_distribution<std::size_t> pick(0, pts.size() - 1);
+        std::vector<std::pair<Sample, Sample>> pairs;
+        for (int i = 0; i < 1024; i++) {
+            pairs.push_back(std::make_pair(pts[pick(rng)], pts[pick(rng)]));
+        }
+        return pairs;
+    });
+}
+
+const double kObserverHeight = 10;
+const double kTargetHeight = 2;
+const double kSightRadius = 0.5;
+
+template <class Tree>
+void BM_LineOfSight(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    const auto& pairs = sight_pairs(state.range(0), state.range(1));
+    std::size_t i = 0, visible = 0;
+    for (auto _ : state) {
+        const auto& pr = pairs[i++ % pairs.size()];
+        typename Tree::Point a(pr.first.x, pr.first.y, pr.first.z), b(pr.second.x, pr.second.y, pr.second.z);
+        visible += tree->line_of_sight(a, b, kObserverHeight, kTargetHeight, kSightRadius);
+    }
+    state.counters["visible"] = benchmark::Counter(static_cast<double>(visible), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+// Baseline without an index: test every sample against the line.
+template <class Tree>
+void BM_LineOfSightBruteForce(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    const auto& pairs = sight_pairs(state.range(0), state.range(1));
+    std::size_t i = 0, visible = 0;
+    for (auto _ : state) {
+        const auto& pr = pairs[i++ % pairs.size()];
+        terrain::SightLine line(pr.first.x, pr.first.y, pr.first.z + kObserverHeight, pr.second.x, pr.second.y, pr.second.z + kTargetHeight, kSightRadius);
+        bool blocked = false;
+        if (!line.degenerate()) {
+            for (auto& s : pts) {
+                if (line.blocks(s.x, s.y, s.z)) {
+                    blocked = true;
+                    break;
+                }
+            }
+        }
+        visible += !blocked;
+    }
+    state.counters["visible"] = benchmark::Counter(static_cast<double>(visible), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+// Baseline using the tree's window queries: march along the ground track in
+// radius-sized steps and query a window around each step, testing every
+// returned sample against the line.
+template <class Tree>
+void BM_LineOfSightByQuery(benchmark::State& state) {
+    typedef typename Tree::Point Point;
+    typedef typename Tree::Rectangle Rectangle;
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    const auto& pairs = sight_pairs(state.range(0), state.range(1));
+    std::vector<Point> found;
+    std::size_t i = 0, visible = 0;
+    for (auto _ : state) {
+        const auto& pr = pairs[i++ % pairs.size()];
+        terrain::SightLine line(pr.first.x, pr.first.y, pr.first.z + kObserverHeight, pr.second.x, pr.second.y, pr.second.z + kTargetHeight, kSightRadius);
+        double length = std::sqrt(line.dx * line.dx + line.dy * line.dy);
+        int steps = static_cast<int>(length / kSightRadius) + 1;
+        bool blocked = false;
+        for (int s = 0; s <= steps && !blocked; s++) {
+            double t = static_cast<double>(s) / steps;
+            found.clear();
+            tree->query(Rectangle(line.x0 + t * line.dx, line.y0 + t * line.dy, kSightRadius, kSightRadius), found);
+            for (auto& p : found) {
+                if (line.blocks(p.x, p.y, p.elevation)) {
+                    blocked = true;
+                    break;
+                }
+            }
+        }
+        visible += !blocked;
+    }
+    state.counters["visible"] = benchmark::Counter(static_cast<double>(visible), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+// Windows of half-extent 50, a quarter of the extent across, for the
+// count/any benchmarks where most visited nodes are fully covered.
+template <class Rectangle>
+const std::vector<Rectangle>& large_windows() {
+    return windows<Rectangle>(50, 29, 1024, 50);
+}
+
+template <class Tree>
+void BM_Count(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    const auto& ranges = large_windows<typename Tree::Rectangle>();
+    std::size_t i = 0, hits = 0;
+    reset_counters(*tree);
+    for (auto _ : state) {
+        hits += tree->count(ranges[i++ % ranges.size()]);
+    }
+    report_counters(state, *tree);
+    state.counters["found"] = benchmark::Counter(static_cast<double>(hits), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+template <class Tree>
+void BM_Any(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    const auto& ranges = large_windows<typename Tree::Rectangle>();
+    std::size_t i = 0, hits = 0;
+    for (auto _ : state) {
+        hits += tree->any(ranges[i++ % ranges.size()]);
+    }
+    state.counters["hit_rate"] = benchmark::Counter(static_cast<double>(hits), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+// Baseline for BM_Count: materialize the window and take its size.
+template <class Tree>
+void BM_QueryCount(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    const auto& ranges = large_windows<typename Tree::Rectangle>();
+    std::vector<typename Tree::Point> found;
+    std::size_t i = 0, hits = 0;
+    for (auto _ : state) {
+        found.clear();
+        tree->query(ranges[i++ % ranges.size()], found);
+        hits += found.size();
+    }
+    state.counters["found"] = benchmark::Counter(static_cast<double>(hits), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+// Map-UI traffic: 64 viewports of half-extent 10, each revisited with up to
+// 0.4 units of jitter, and one new sample inserted every 16 queries.
+template <class Rectangle>
+const std::vector<Rectangle>& viewports() {
+    static Memo<int, std::vector<Rectangle>> memo;
+    return memo.get(0, [] {
+        const auto& home = windows<Rectangle>(10, 31, 64, 10);
+        std::mt19937_64 rng(37);
+        std::uniform_real_distribution<double> jitter(-0.4, 0.4);
+        std::uniform_int_distribution<std::size_t> pick(0, home.size() - 1);
+        std::vector<Rectangle> out;
+        for (int i = 0; i < 4096; i++) {
+            const Rectangle& c = home[pick(rng)];
+            out.push_back(Rectangle(c.x + jitter(rng), c.y + jitter(rng), c.width, c.height));
+        }
+        return out;
+    });
+}
+
+template <class Tree>
+void BM_ViewportQuery(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    const auto& ranges = viewports<typename Tree::Rectangle>();
+    const auto& extra = dataset(state.range(0), 10000);
+    std::vector<typename Tree::Point> found;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        if (i % 16 == 15) {
+            const Sample& s = extra[(i / 16) % extra.size()];
+            tree->insert(typename Tree::Point(s.x, s.y, s.z));
+        }
+        found.clear();
+        tree->query(ranges[i++ % ranges.size()], found);
+        benchmark::DoNotOptimize(found.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+template <class Tree>
+void BM_CachedViewportQuery(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    terrain::QueryCache<Tree> cache(*tree);
+    const auto& ranges = viewports<typename Tree::Rectangle>();
+    const auto& extra = dataset(state.range(0), 10000);
+    std::vector<typename Tree::Point> found;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        if (i % 16 == 15) {
+            const Sample& s = extra[(i / 16) % extra.size()];
+            cache.insert(typename Tree::Point(s.x, s.y, s.z));
+        }
+        found.clear();
+        cache.query(ranges[i++ % ranges.size()], found);
+        benchmark::DoNotOptimize(found.data());
+    }
+    terrain::QueryCacheStats stats = cache.stats();
+    state.counters["hit_rate"] = stats.hit_rate();
+    state.counters["invalidations"] = static_cast<double>(stats.invalidations);
+    state.counters["cache_bytes"] = static_cast<double>(stats.bytes);
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+// Star-shaped district boundaries (radius 10-30, 6-16 vertices) and
+// five-vertex pipelines with a 3-unit right of way, scattered over the extent.
+template <class Region>
+const std::vector<Region>& regions();
+
+template <>
+const std::vector<terrain::Polygon>& regions<terrain::Polygon>() {
+    static std::vector<terrain::Polygon> out;
+    if (out.empty()) {
+        std::mt19937_64 rng(13);
+        std::uniform_real_distribution<double> coord(terrain_bench::kMin + 30, terrain_bench::kMax - 30);
+        std::uniform_real_distribution<double> radius(10, 30);
+        for (int i = 0; i < 256; i++) {
+            double cx = coord(rng), cy = coord(rng);
+            int n = 6 + i % 11;
+            std::vector<terrain::Polygon::Vertex> v;
+            for (int k = 0; k < n; k++) {
+                double a = 2 * M_PI * k / n, r = radius(rng);
+                v.push_back({cx + r * std::cos(a), cy + r * std::sin(a)});
+            }
+            out.push_back(terrain::Polygon(std::move(v)));
+        }
+    }
+    return out;
+}
+
+template <>
+const std::vector<terrain::Corridor>& regions<terrain::Corridor>() {
+    static std::vector<terrain::Corridor> out;
+    if (out.empty()) {
+        std::mt19937_64 rng(17);
+        std::uniform_real_distribution<double> coord(terrain_bench::kMin + 50, terrain_bench::kMax - 50);
+        std::uniform_real_distribution<double> step(-20, 20);
+        for (int i = 0; i < 256; i++) {
+            std::vector<terrain::Corridor::Vertex> path{{coord(rng), coord(rng)}};
+            for (int k = 0; k < 4; k++) {
+                path.push_back({path.back().x + step(rng), path.back().y + step(rng)});
+            }
+            out.push_back(terrain::Corridor(std::move(path), 3));
+        }
+    }
+    return out;
+}
+
+template <class Tree, class Region>
+void BM_RegionQuery(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    const auto& shapes = regions<Region>();
+    std::vector<typename Tree::Point> found;
+    std::size_t i = 0, hits = 0;
+    reset_counters(*tree);
+    for (auto _ : state) {
+        found.clear();
+        tree->query(shapes[i++ % shapes.size()], found);
+        hits += found.size();
+        benchmark::DoNotOptimize(found.data());
+    }
+    report_counters(state, *tree);
+    state.counters["found"] = benchmark::Counter(static_cast<double>(hits), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+// Baseline: query the region's bounding box, then test every hit.
+template <class Tree, class Region>
+void BM_RegionByBoundingBox(benchmark::State& state) {
+    typedef typename Tree::Rectangle Rectangle;
+    const auto& pts = dataset(state.range(0), state.range(1));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    const auto& shapes = regions<Region>();
+    std::vector<typename Tree::Point> box, found;
+    std::size_t i = 0, hits = 0;
+    for (auto _ : state) {
+        const Region& r = shapes[i++ % shapes.size()];
+        box.clear();
+        found.clear();
+        tree->query(Rectangle((r.minx + r.maxx) / 2, (r.miny + r.maxy) / 2, (r.maxx - r.minx) / 2, (r.maxy - r.miny) / 2), box);
+        for (auto& p : box) {
+            if (r.contains(p.x, p.y)) {
+                found.push_back(p);
+            }
+        }
+        hits += found.size();
+        benchmark::DoNotOptimize(found.data());
+    }
+    state.counters["found"] = benchmark::Counter(static_cast<double>(hits), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations());
+    set_terrain(state);
+}
+
+// Feeds a whole dataset the way a sensor thread would. feed_max_us is the
+// worst single call on the feed thread, which for direct inserts includes any
+// subdivide cascade.
+template <class Tree>
+void BM_DirectFeed(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    double worst = 0;
+    for (auto _ : state) {
+        auto tree = make_tree<Tree>();
+        for (auto& s : pts) {
+            auto start = std::chrono::steady_clock::now();
+            tree->insert(typename Tree::Point(s.x, s.y, s.z));
+            worst = std::max(worst, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        benchmark::DoNotOptimize(tree.get());
+    }
+    state.counters["feed_max_us"] = worst;
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(pts.size()));
+    set_terrain(state);
+}
+
+template <class Tree>
+void BM_StreamingIngest(benchmark::State& state) {
+    const auto& pts = dataset(state.range(0), state.range(1));
+    terrain::IngestOptions options;
+    options.commit_interval = std::chrono::milliseconds(5);
+    double worst = 0;
+    terrain::IngestStats stats;
+    for (auto _ : state) {
+        auto tree = make_tree<Tree>();
+        {
+            terrain::StreamingIngestor<Tree> ingest(*tree, options);
+            for (auto& s : pts) {
+                auto start = std::chrono::steady_clock::now();
+                ingest.push(typename Tree::Point(s.x, s.y, s.z));
+                worst = std::max(worst, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            }
+            ingest.flush();
+            stats = ingest.stats();
+        }
+        benchmark::DoNotOptimize(tree.get());
+    }
+    state.counters["feed_max_us"] = worst;
+    state.counters["batches"] = static_cast<double>(stats.batches);
+    state.counters["commit_us_mean"] = stats.commit_us_mean();
+    state.counters["commit_us_max"] = stats.commit_us_max;
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(pts.size()));
+    set_terrain(state);
+}
+
+// 64x64-cell viewshed over the whole extent; second argument is the thread count.
+template <class Tree>
+void BM_Viewshed(benchmark::State& state) {
+    const auto& pts = dataset(kFractal, state.range(0));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    typename Tree::Point observer(pts[0].x, pts[0].y, pts[0].z);
+    double cell = (terrain_bench::kMax - terrain_bench::kMin) / 64;
+    terrain::ViewshedGrid grid{terrain_bench::kMin + cell / 2, terrain_bench::kMin + cell / 2, cell, 64, 64};
+    for (auto _ : state) {
+        auto vis = terrain::viewshed(*tree, observer, grid, kObserverHeight, kTargetHeight, kSightRadius, static_cast<unsigned>(state.range(1)));
+        benchmark::DoNotOptimize(vis.data());
+    }
+    state.SetItemsProcessed(state.iterations() * 64 * 64);
+}
+
+// Point counts crossed with 1..8 worker threads.
+void threaded_sizes(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"n", "threads"});
+    for (long long n = 10000; n <= max_points(); n *= 10) {
+        for (long long threads = 1; threads <= 8; threads *= 2) {
+            b->Args({n, threads});
+        }
+    }
+}
+
+terrain::TilePyramidOptions pyramid_options(unsigned threads) {
+    terrain::TilePyramidOptions options;
+    options.max_zoom = 5;
+    options.tile_size = 64;
+    options.threads = threads;
+    return options;
+}
+
+// Whole pyramid from one tree walk, encoded on `threads` workers into a sink
+// that only counts bytes.
+template <class Tree>
+void BM_TilePyramid(benchmark::State& state) {
+    const auto& pts = dataset(kFractal, state.range(0));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    terrain::TilePyramidOptions options = pyramid_options(static_cast<unsigned>(state.range(1)));
+    std::size_t tiles = 0;
+    for (auto _ : state) {
+        std::atomic<std::size_t> bytes(0);
+        auto stats = terrain::export_tile_pyramid(*tree, options, [&](int, int, int, const std::string& b) {
+            bytes += b.size();
+            return true;
+        });
+        tiles = 0;
+        for (auto t : stats.tiles) {
+            tiles += t;
+        }
+        benchmark::DoNotOptimize(bytes.load());
+    }
+    state.counters["tiles"] = static_cast<double>(tiles);
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(tiles));
+}
+
+// Baseline: one query() per tile per zoom, rasterized and encoded in turn.
+template <class Tree>
+void BM_TilePyramidByQuery(benchmark::State& state) {
+    typedef typename Tree::Point Point;
+    typedef typename Tree::Rectangle Rectangle;
+    const auto& pts = dataset(kFractal, state.range(0));
+    auto tree = make_tree<Tree>();
+    fill(*tree, pts);
+    terrain::TilePyramidOptions options = pyramid_options(1);
+    const int T = options.tile_size;
+    const double extent = terrain_bench::kMax - terrain_bench::kMin;
+    std::vector<Point> found;
+    std::vector<double> sum(static_cast<std::size_t>(T) * T);
+    std::vector<std::uint32_t> count(sum.size());
+    std::vector<std::int32_t> heights(sum.size());
+    terrain::TileCodec codec(T, options.encoding);
+    std::size_t tiles = 0;
+    for (auto _ : state) {
+        std::size_t bytes = 0;
+        tiles = 0;
+        for (int z = 0; z <= options.max_zoom; z++) {
+            double tw = extent / (1 << z);
+            for (int ty = 0; ty < (1 << z); ty++) {
+                for (int tx = 0; tx < (1 << z); tx++) {
+                    double minx = terrain_bench::kMin + tx * tw, miny = terrain_bench::kMin + ty * tw;
+                    found.clear();
+                    tree->query(Rectangle(minx + tw / 2, miny + tw / 2, tw / 2, tw / 2), found);
+                    if (found.empty()) {
+                        continue;
+                    }
+                    std::fill(sum.begin(), sum.end(), 0.0);
+                    std::fill(count.begin(), count.end(), 0);
+                    for (auto& p : found) {
+                        int cx = std::min(T - 1, std::max(0, static_cast<int>((p.x - minx) / (tw / T))));
+                        int cy = std::min(T - 1, std::max(0, static_cast<int>((p.y - miny) / (tw / T))));
+                        sum[cy * T + cx] += p.elevation;
+                        count[cy * T + cx]++;
+                    }
+                    for (std::size_t i = 0; i < sum.size(); i++) {
+                        heights[i] = count[i] ? static_cast<std::int32_t>(std::round(sum[i] / count[i] / options.vertical_resolution)) : terrain::kTileNoData;
+                    }
+                    bytes += codec.encode(heights).size();
+                    tiles++;
+                }
+            }
+        }
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.counters["tiles"] = static_cast<double>(tiles);
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(tiles));
+}
+
+// Run-length encodes the depth-first leaf values of a fractal DEM quantized to
+// 25 m bands. compressRLE works in place, so the input copy is part of the
+// measured time.
+void BM_RLEEncode(benchmark::State& state) {
+    std::size_t n = static_cast<std::size_t>(state.range(0));
+    std::vector<double> dem = terrain_bench::diamond_square(10, 0.55, 1);
+    std::vector<int> values;
+    values.reserve(n);
+    while (values.size() < n) {
+        for (std::size_t i = 0; i < dem.size() && values.size() < n; i++) {
+            values.push_back(static_cast<int>(std::floor(dem[i] / 25)));
+        }
+    }
+    std::size_t encoded = 0;
+    for (auto _ : state) {
+        std::vector<int> work = values;
+        terrain::compressRLE(work);
+        encoded = work.size();
+        benchmark::DoNotOptimize(work.data());
+    }
+    state.counters["ratio"] = static_cast<double>(encoded) / static_cast<double>(n);
+    state.SetBytesProcessed(state.iterations() * static_cast<long long>(n * sizeof(int)));
+}
+
+void point_sizes(benchmark::internal::Benchmark* b) {
+    for (long long n = 10000; n <= max_points(); n *= 10) {
+        b->Arg(n);
+    }
+}
+
+// A later survey of the fractal dataset: every sample moved up to 0.25 units
+// sideways and up to 1 unit vertically.
+const std::vector<Sample>& resurvey(std::size_t n) {
+    static Memo<std::size_t, std::vector<Sample>> memo;
+    return memo.get(n, [&] {
+        std::mt19937_64 rng(19);
+        std::uniform_real_distribution<double> shift(-0.25, 0.25), lift(-1, 1);
+        std::vector<Sample> pts = dataset(kFractal, n);
+        for (auto& s : pts) {
+            s.x += shift(rng);
+            s.y += shift(rng);
+            s.z += lift(rng);
+        }
+        return pts;
+    });
+}
+
+const double kJoinTolerance = 0.5;
+
+template <class Tree>
+void BM_SpatialJoin(benchmark::State& state) {
+    auto old_tree = make_tree<Tree>();
+    fill(*old_tree, dataset(kFractal, state.range(0)));
+    auto new_tree = make_tree<Tree>();
+    fill(*new_tree, resurvey(state.range(0)));
+    terrain::JoinOptions options;
+    options.tolerance = kJoinTolerance;
+    options.threads = static_cast<unsigned>(state.range(1));
+    std::size_t matches = 0;
+    for (auto _ : state) {
+        auto result = terrain::spatial_join(*old_tree, *new_tree, options);
+        matches = result.matches;
+        benchmark::DoNotOptimize(result.pairs.data());
+    }
+    state.counters["matches"] = static_cast<double>(matches);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Baseline: one window query into the old tree per point of the new one.
+template <class Tree>
+void BM_JoinByQuery(benchmark::State& state) {
+    typedef typename Tree::Point Point;
+    auto old_tree = make_tree<Tree>();
+    fill(*old_tree, dataset(kFractal, state.range(0)));
+    const auto& fresh = resurvey(state.range(0));
+    std::vector<Point> found;
+    std::vector<std::pair<Point, Point>> pairs;
+    for (auto _ : state) {
+        pairs.clear();
+        for (auto& s : fresh) {
+            found.clear();
+            old_tree->query(typename Tree::Rectangle(s.x, s.y, kJoinTolerance, kJoinTolerance), found);
+            for (auto& p : found) {
+                double dx = p.x - s.x, dy = p.y - s.y;
+                if (dx * dx + dy * dy <= kJoinTolerance * kJoinTolerance) {
+                    pairs.emplace_back(p, Point(s.x, s.y, s.z));
+                }
+            }
+        }
+        benchmark::DoNotOptimize(pairs.data());
+    }
+    state.counters["matches"] = static_cast<double>(pairs.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+const char* const kOrderNames[] = {"depth_first", "z_order", "hilbert"};
+
+void layout_sizes(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"order", "n"});
+    for (long long n = 10000; n <= max_points(); n *= 10) {
+        for (int order = 0; order < 3; order++) {
+            b->Args({order, n});
+        }
+    }
+}
+
+// Windows of half-extent 8: big enough to cross several subtrees, which is
+// where node order decides how many pages a query touches.
+template <class Rectangle>
+const std::vector<Rectangle>& wide_windows() {
+    return windows<Rectangle>(8, 23, 256);
+}
+
+// Cold-cache query against a serialized tree: every iteration first drops
+// the file from the mapping and page cache, then runs one window query.
+// Faults are counted with getrusage around the query alone.
+void BM_LayoutColdQuery(benchmark::State& state) {
+    terrain::NodeOrder order = static_cast<terrain::NodeOrder>(state.range(0));
+    const auto& pts = dataset(kFractal, state.range(1));
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("terrain_bench_" + std::string(kOrderNames[state.range(0)]) + "_" + std::to_string(state.range(1)) + ".layout")).string();
+    {
+        auto tree = make_tree<CountTree>();
+        fill(*tree, pts);
+        if (!terrain::write_layout(*tree, path, order)) {
+            state.SkipWithError("cannot write layout file");
+            return;
+        }
+    }
+    terrain::MappedLayout layout(path);
+    const auto& ranges = wide_windows<terrain::MappedLayout::Rectangle>();
+    std::vector<terrain::MappedLayout::Point> found;
+    std::size_t i = 0;
+    long long minor = 0, major = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        layout.drop_cache();
+        found.clear();
+        struct rusage before, after;
+        getrusage(RUSAGE_SELF, &before);
+        state.ResumeTiming();
+        layout.query(ranges[i++ % ranges.size()], found);
+        state.PauseTiming();
+        getrusage(RUSAGE_SELF, &after);
+        minor += after.ru_minflt - before.ru_minflt;
+        major += after.ru_majflt - before.ru_majflt;
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(found.data());
+    }
+    state.counters["minor_faults"] = benchmark::Counter(static_cast<double>(minor), benchmark::Counter::kAvgIterations);
+    state.counters["major_faults"] = benchmark::Counter(static_cast<double>(major), benchmark::Counter::kAvgIterations);
+    state.counters["file_bytes"] = static_cast<double>(layout.file_bytes());
+    state.SetLabel(kOrderNames[state.range(0)]);
+    std::filesystem::remove(path);
+}
+
+}  // namespace
+
+#define TERRAIN_TREE_BENCHMARKS(Tree)                                         \
+    BENCHMARK_TEMPLATE(BM_BulkBuild, Tree)->Apply(terrain_sizes)->Unit(benchmark::kMillisecond); \
+    BENCHMARK_TEMPLATE(BM_Insert, Tree)->Apply(terrain_sizes);                \
+    BENCHMARK_TEMPLATE(BM_Query, Tree)->Apply(query_sizes);                   \
+    BENCHMARK_TEMPLATE(BM_Intersect, Tree)->Apply(terrain_sizes)
+
+TERRAIN_TREE_BENCHMARKS(CountTree);
+TERRAIN_TREE_BENCHMARKS(AdaptiveTree);
+
+// Leaf capacity sweep: build cost and footprint against query cost.
+#define TERRAIN_CAPACITY_BENCHMARKS(Capacity)                                 \
+    BENCHMARK_TEMPLATE(BM_BulkBuild, CapacityTree<Capacity>)->Apply(uniform_sizes)->Unit(benchmark::kMillisecond); \
+    BENCHMARK_TEMPLATE(BM_Query, CapacityTree<Capacity>)->Apply(uniform_sizes)
+
+TERRAIN_CAPACITY_BENCHMARKS(1);
+TERRAIN_CAPACITY_BENCHMARKS(2);
+TERRAIN_CAPACITY_BENCHMARKS(4);
+TERRAIN_CAPACITY_BENCHMARKS(8);
+TERRAIN_CAPACITY_BENCHMARKS(16);
+TERRAIN_CAPACITY_BENCHMARKS(32);
+TERRAIN_CAPACITY_BENCHMARKS(64);
+
+BENCHMARK_TEMPLATE(BM_Query, InstrumentedTree)->Apply(terrain_sizes);
+
+BENCHMARK_TEMPLATE(BM_Compress, CountTree)->Apply(terrain_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Compress, AdaptiveTree)->Apply(terrain_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_InsertAfterCompress, CountTree)->Apply(terrain_sizes);
+BENCHMARK_TEMPLATE(BM_InsertAfterCompress, AdaptiveTree)->Apply(terrain_sizes);
+
+BENCHMARK_TEMPLATE(BM_IsSmooth, CountTree)->Apply(terrain_sizes);
+
+BENCHMARK_TEMPLATE(BM_LineOfSight, CountTree)->Apply(terrain_sizes);
+BENCHMARK_TEMPLATE(BM_LineOfSightByQuery, CountTree)->Apply(terrain_sizes);
+BENCHMARK_TEMPLATE(BM_LineOfSightBruteForce, CountTree)->Apply(terrain_sizes);
+BENCHMARK_TEMPLATE(BM_Count, CountTree)->Apply(terrain_sizes);
+BENCHMARK_TEMPLATE(BM_Count, InstrumentedTree)->Apply(terrain_sizes);
+BENCHMARK_TEMPLATE(BM_Any, CountTree)->Apply(terrain_sizes);
+BENCHMARK_TEMPLATE(BM_QueryCount, CountTree)->Apply(terrain_sizes);
+
+BENCHMARK_TEMPLATE(BM_ViewportQuery, CountTree)->Apply(terrain_sizes);
+BENCHMARK_TEMPLATE(BM_CachedViewportQuery, CountTree)->Apply(terrain_sizes);
+
+BENCHMARK_TEMPLATE(BM_RegionQuery, CountTree, terrain::Polygon)->Apply(terrain_sizes);
+BENCHMARK_TEMPLATE(BM_RegionByBoundingBox, CountTree, terrain::Polygon)->Apply(terrain_sizes);
+BENCHMARK_TEMPLATE(BM_RegionQuery, CountTree, terrain::Corridor)->Apply(terrain_sizes);
+BENCHMARK_TEMPLATE(BM_RegionByBoundingBox, CountTree, terrain::Corridor)->Apply(terrain_sizes);
+BENCHMARK_TEMPLATE(BM_RegionQuery, InstrumentedTree, terrain::Polygon)->Apply(terrain_sizes);
+
+BENCHMARK_TEMPLATE(BM_DirectFeed, CountTree)->Apply(terrain_sizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_StreamingIngest, CountTree)->Apply(terrain_sizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_TEMPLATE(BM_Viewshed, CountTree)->Apply(threaded_sizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_TEMPLATE(BM_TilePyramid, CountTree)->Apply(threaded_sizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TilePyramidByQuery, CountTree)->Apply(point_sizes)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_SpatialJoin, CountTree)->Apply(threaded_sizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_JoinByQuery, CountTree)->Apply(point_sizes)->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_LayoutColdQuery)->Apply(layout_sizes)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_RLEEncode)->Apply(point_sizes);
+
+int main(int argc, char** argv) {
+    static CountingMemoryManager memory_manager;
+    benchmark::RegisterMemoryManager(&memory_manager);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::RegisterMemoryManager(nullptr);
+    benchmark::Shutdown();
+    return 0;
+}
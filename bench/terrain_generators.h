@@ -0,0 +1,126 @@
+#ifndef TERRAIN_GENERATORS_H
+#define TERRAIN_GENERATORS_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Synthetic terrain for the benchmarks. Every generator is deterministic for a
+// given (n, seed) and fills the square [-300, 100] x [-300, 100], which is the
+// extent of the Rectangle(-100, -100, 200, 200) root the example programs use.
+namespace terrain_bench {
+
+const double kMin = -300;
+const double kMax = 100;
+
+struct Sample {
+    double x, y, z;
+};
+
+// Points scattered uniformly with smooth rolling elevation.
+inline std::vector<Sample> uniform_terrain(std::size_t n, std::uint32_t seed = 1) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> coord(kMin, kMax);
+    std::vector<Sample> out;
+    out.reserve(n);
+    for (std::size_t i = 0; i < n; i++) {
+        double x = coord(rng), y = coord(rng);
+        out.push_back(Sample{x, y, 50 * std::sin(x / 40) * std::cos(y / 40)});
+    }
+    return out;
+}
+
+// Points scattered uniformly over a gently tilted plane: no elevation error
+// at all, the best case for an error-driven split rule.
+inline std::vector<Sample> flat_terrain(std::size_t n, std::uint32_t seed = 1) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> coord(kMin, kMax);
+    std::vector<Sample> out;
+    out.reserve(n);
+    for (std::size_t i = 0; i < n; i++) {
+        double x = coord(rng), y = coord(rng);
+        out.push_back(Sample{x, y, 0.05 * x - 0.02 * y});
+    }
+    return out;
+}
+
+// Points bunched into Gaussian survey patches, leaving most of the extent
+// empty; stresses deep, unbalanced subtrees.
+inline std::vector<Sample> clustered_terrain(std::size_t n, std::uint32_t seed = 1) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> coord(kMin + 20, kMax - 20);
+    std::vector<Sample> centres;
+    for (int i = 0; i < 32; i++) {
+        centres.push_back(Sample{coord(rng), coord(rng), coord(rng)});
+    }
+    std::normal_distribution<double> spread(0, 4);
+    std::uniform_int_distribution<std::size_t> pick(0, centres.size() - 1);
+    std::vector<Sample> out;
+    out.reserve(n);
+    while (out.size() < n) {
+        const Sample& c = centres[pick(rng)];
+        double x = c.x + spread(rng), y = c.y + spread(rng);
+        if (x < kMin || x > kMax || y < kMin || y > kMax) {
+            continue;
+        }
+        out.push_back(Sample{x, y, c.z + spread(rng)});
+    }
+    return out;
+}
+
+// Diamond-square heightmap on a (2^k + 1)^2 grid with the given roughness.
+inline std::vector<double> diamond_square(int k, double roughness, std::uint32_t seed) {
+    int size = (1 << k) + 1;
+    std::vector<double> h(static_cast<std::size_t>(size) * size, 0.0);
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> jitter(-1, 1);
+    auto at = [&](int x, int y) -> double& { return h[static_cast<std::size_t>(y) * size + x]; };
+    double scale = 200;
+    for (int step = size - 1; step > 1; step /= 2) {
+        int half = step / 2;
+        for (int y = half; y < size; y += step) {
+            for (int x = half; x < size; x += step) {
+                double avg = (at(x - half, y - half) + at(x + half, y - half) + at(x - half, y + half) + at(x + half, y + half)) / 4;
+                at(x, y) = avg + jitter(rng) * scale;
+            }
+        }
+        for (int y = 0; y < size; y += half) {
+            for (int x = (y / half) % 2 == 0 ? half : 0; x < size; x += step) {
+                double sum = 0;
+                int count = 0;
+                if (x >= half) { sum += at(x - half, y); count++; }
+                if (x + half < size) { sum += at(x + half, y); count++; }
+                if (y >= half) { sum += at(x, y - half); count++; }
+                if (y + half < size) { sum += at(x, y + half); count++; }
+                at(x, y) = sum / count + jitter(rng) * scale;
+            }
+        }
+        scale *= roughness;
+    }
+    return h;
+}
+
+// Points sampled at random from a fractal DEM; realistic mix of flat and
+// rugged regions.
+inline std::vector<Sample> fractal_terrain(std::size_t n, std::uint32_t seed = 1) {
+    const int k = 10;
+    const int size = (1 << k) + 1;
+    std::vector<double> dem = diamond_square(k, 0.55, seed);
+    std::mt19937_64 rng(seed + 1);
+    std::uniform_real_distribution<double> coord(kMin, kMax);
+    std::vector<Sample> out;
+    out.reserve(n);
+    for (std::size_t i = 0; i < n; i++) {
+        double x = coord(rng), y = coord(rng);
+        int gx = static_cast<int>((x - kMin) / (kMax - kMin) * (size - 1));
+        int gy = static_cast<int>((y - kMin) / (kMax - kMin) * (size - 1));
+        out.push_back(Sample{x, y, dem[static_cast<std::size_t>(gy) * size + gx]});
+    }
+    return out;
+}
+
+}  // namespace terrain_bench
+
+#endif
@@ -0,0 +1,54 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <cstddef>
+
+#include "terrain/quadtree.h"
+using namespace std;
+using namespace terrain;
+
+// Runs window queries on an instrumented tree, prints the counters and writes
+// every query as a span to a Chrome trace file.
+void trace(const string& path, size_t n) {
+    mt19937 rng(42);
+    uniform_real_distribution<double> coord(-300, 100);
+    uniform_real_distribution<double> elev(0, 1000);
+    Quadtree<InstrumentedPolicy> qt(Rectangle(-100, -100, 200, 200));
+    for (size_t i = 0; i < n; i++) {
+        qt.insert(Point(coord(rng), coord(rng), elev(rng)));
+    }
+    cout << "build " << qt.instrumentation().counters.to_json() << std::endl;
+    TraceRecorder recorder;
+    qt.instrumentation().reset();
+    qt.instrumentation().trace = &recorder;
+    for (int i = 0; i < 100; i++) {
+        std::vector<Point> found;
+        qt.query(Rectangle(coord(rng), coord(rng), 5, 5), found);
+    }
+    cout << "queries " << qt.instrumentation().counters.to_json() << std::endl;
+    if (!recorder.write_chrome_trace(path)) {
+        cerr << "cannot write " << path << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 2 && string(argv[1]) == "--trace") {
+        trace(argv[2], argc > 3 ? stoul(argv[3]) : 200000);
+        return 0;
+    }
+    Rectangle boundary(-100, -100, 200, 200);
+    Quadtree<> qt(boundary);
+    qt.insert(Point(1, 2,0.0));
+    qt.insert(Point(-3, 4,10.0));
+    qt.insert(Point(10, 20,2.0));
+    qt.insert(Point(-30, -40,7.0));
+    std::vector<Point> found;
+    Rectangle range(-5, -5, 10, 10);
+    qt.query(range, found);
+    for (auto p : found) {
+        std::cout << "(" << p.x << ", " << p.y << ")" << p.elevation << std::endl;
+    }
+    return 0;
+}
+//Normal Quadtree
@@ -1,6 +1,9 @@
 #include <iostream>
 #include <vector>
 
+#include "terrain/rle.h"
+using terrain::compressRLE;
+
 struct QuadtreeNode {
     float x;
     float y;
@@ -10,28 +13,6 @@ struct QuadtreeNode {
     QuadtreeNode* children[4];
 };
 
-void compressRLE(std::vector<int>& values) {
-    std::vector<int> compressed;
-    int count = 1;
-    int currentValue = values[0];
-
-    for (int i = 1; i < values.size(); i++) {
-        if (values[i] == currentValue) {
-            count++;
-        } else {
-            compressed.push_back(currentValue);
-            compressed.push_back(count);
-            count = 1;
-            currentValue = values[i];
-        }
-    }
-
-    compressed.push_back(currentValue);
-    compressed.push_back(count);
-
-    values = compressed;
-}
-
 int main() {
     QuadtreeNode* root = new QuadtreeNode();
     root->x = 0;
@@ -96,7 +77,7 @@ int main() {
 
     // Output the compressed values
     std::cout << "Compressed values: ";
-    for (int i = 0; i < values.size(); i++) {
+    for (std::size_t i = 0; i < values.size(); i++) {
         std::cout << values[i] << " ";
     }
     std::cout << std::endl;
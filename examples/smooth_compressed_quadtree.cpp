@@ -0,0 +1,44 @@
+#include <iostream>
+#include <vector>
+#include <fstream>
+#include <string>
+#include <sstream>
+
+#include "terrain/quadtree.h"
+using namespace std;
+using namespace terrain;
+
+// Loads "x y elevation" lines from the file named on the command line
+// (points.txt by default), compresses the tree and runs a window query.
+int main(int argc, char** argv)
+{
+    Rectangle boundary(-100, -100, 200, 200);
+    Quadtree<> qt(boundary);
+    std::string line;
+    std::ifstream file(argc > 1 ? argv[1] : "points.txt");
+    if (!file.is_open())
+    {
+        std::cerr << "cannot open " << (argc > 1 ? argv[1] : "points.txt") << std::endl;
+        return 1;
+    }
+    while (getline(file, line))
+    {
+        std::istringstream iss(line);
+        double x, y, elevation;
+        if (iss >> x >> y >> elevation)
+        {
+            qt.insert(Point(x, y, elevation));
+        }
+    }
+    file.close();
+    qt.compress();
+    std::vector<Point> found;
+    Rectangle range(-5, -5, 10, 10);
+    qt.query(range, found);
+    for (auto p : found)
+    {
+        std::cout << "(" << p.x << ", " << p.y << ")" << p.elevation << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+#include <iostream>
+#include <vector>
+
+#include "terrain/quadtree.h"
+using namespace std;
+using namespace terrain;
+
+int main() {
+    Rectangle boundary(-100, -100, 200, 200);
+    Quadtree<> qt(boundary);
+    qt.insert(Point(1, 2,0.0));
+    qt.insert(Point(-3, 4,10.0));
+    qt.insert(Point(10, 20,2.0));
+    qt.insert(Point(-30, -40,7.0));
+    std::vector<Point> found;
+    Rectangle range(-5, -5, 10, 10);
+    qt.query(range, found);
+    for (auto p : found) {
+        std::cout << "(" << p.x << ", " << p.y << ")" << p.elevation << std::endl;
+    }
+    std::cout << "smooth: " << qt.is_smooth(range, 2) << std::endl;
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef TERRAIN_GEOMETRY_H
+#define TERRAIN_GEOMETRY_H
+
+namespace terrain {
+
+template <typename Coord, typename Payload>
+class BasicPoint {
+public:
+    Coord x, y;
+    Payload elevation;
+    BasicPoint() : x(), y(), elevation() {}
+    BasicPoint(Coord x_, Coord y_, Payload val) : x(x_), y(y_), elevation(val) {}
+};
+typedef BasicPoint<double, double> Point;
+
+// Axis-aligned box given by its centre (x, y) and half-extents width/height.
+template <typename Coord>
+class BasicRectangle {
+public:
+    Coord x, y, width, height;
+    BasicRectangle(Coord x_, Coord y_, Coord w_, Coord h_) : x(x_), y(y_), width(w_), height(h_) {}
+    template <typename P>
+    bool contains(const P& p) const {
+        return (p.x >= x - width && p.x <= x + width && p.y >= y - height && p.y <= y + height);
+    }
+    // Whether other lies entirely inside this box.
+    bool covers(const BasicRectangle& other) const {
+        return (other.x - other.width >= x - width && other.x + other.width <= x + width && other.y - other.height >= y - height && other.y + other.height <= y + height);
+    }
+    bool intersects(const BasicRectangle& other) const {
+        return (x - width <= other.x + other.width && x + width >= other.x - other.width && y - height <= other.y + other.height && y + height >= other.y - other.height);
+    }
+};
+typedef BasicRectangle<double> Rectangle;
+
+}  // namespace terrain
+
+#endif
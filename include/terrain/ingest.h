@@ -0,0 +1,295 @@
+#ifndef TERRAIN_INGEST_H
+#define TERRAIN_INGEST_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "terrain/morton.h"
+
+namespace terrain {
+
+struct IngestOptions {
+    std::size_t queue_capacity = 1 << 16;  // points; rounded up to a power of two
+    std::chrono::microseconds commit_interval = std::chrono::milliseconds(20);
+    std::size_t max_batch = 1 << 14;       // points merged per tree lock
+};
+
+// Snapshot of a StreamingIngestor's counters. Commit latency is the time the
+// tree is held exclusively for one batch.
+struct IngestStats {
+    std::uint64_t accepted = 0;    // points taken by push()/try_push()
+    std::uint64_t rejected = 0;    // try_push() calls that found the queue full
+    std::uint64_t committed = 0;   // points inserted into the tree
+    std::uint64_t outside = 0;     // points the tree refused (out of bounds)
+    std::uint64_t batches = 0;
+    double commit_us_total = 0;
+    double commit_us_max = 0;
+    double commit_us_last = 0;
+    double elapsed_s = 0;          // since the ingestor started
+
+    double points_per_second() const { return elapsed_s > 0 ? committed / elapsed_s : 0; }
+    double commit_us_mean() const { return batches ? commit_us_total / batches : 0; }
+};
+
+namespace detail {
+
+// Bounded lock-free multi-producer queue (Vyukov): each cell carries a
+// sequence number telling producers and the consumer whose turn it is.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) : mask(round_up(capacity) - 1), cells(new Cell[mask + 1]), head(0), tail(0) {
+        for (std::size_t i = 0; i <= mask; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    std::size_t capacity() const { return mask + 1; }
+    bool try_push(const T& value) {
+        std::size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    // Single consumer.
+    bool try_pop(T& value) {
+        std::size_t pos = head.load(std::memory_order_relaxed);
+        Cell& cell = cells[pos & mask];
+        std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1) < 0) {
+            return false;
+        }
+        value = cell.value;
+        cell.sequence.store(pos + mask + 1, std::memory_order_release);
+        head.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+    static std::size_t round_up(std::size_t n) {
+        std::size_t p = 1;
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+    std::size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<std::size_t> head;
+    alignas(64) std::atomic<std::size_t> tail;
+};
+
+}  // namespace detail
+
+// Buffers points from any number of feed threads in a bounded lock-free
+// queue and merges them into `tree` from a background thread, one batch per
+// commit_interval (or sooner on flush()). Each batch is sorted into Z-order
+// over the tree's bounds first, so consecutive inserts walk the same path and
+// a subdivide cascade is paid once per batch instead of on the feed thread.
+//
+// While the ingestor lives, touch the tree only through read() and write(),
+// which take the lock the commits use. Throws std::invalid_argument for a zero
+// queue_capacity or max_batch, or a commit_interval that is not positive.
+template <typename Tree>
+class StreamingIngestor {
+public:
+    typedef typename Tree::Point Point;
+
+    StreamingIngestor(Tree& tree_, const IngestOptions& options_ = IngestOptions())
+        : tree(tree_), options(checked(options_)), queue(options_.queue_capacity), accepted(0), rejected(0),
+          started(std::chrono::steady_clock::now()), stopping(false), wake(false), worker([this] { run(); }) {}
+    StreamingIngestor(const StreamingIngestor&) = delete;
+    StreamingIngestor& operator=(const StreamingIngestor&) = delete;
+    // Commits everything still queued before returning.
+    ~StreamingIngestor() {
+        {
+            std::lock_guard<std::mutex> lock(signal);
+            stopping = true;
+        }
+        wakeup.notify_one();
+        worker.join();
+    }
+
+    // Never blocks; false when the queue is full.
+    bool try_push(const Point& p) {
+        if (!queue.try_push(p)) {
+            rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        accepted.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+    // Yields until the point fits, so a slow tree backs up into the feed
+    // instead of growing the buffer.
+    void push(const Point& p) {
+        while (!queue.try_push(p)) {
+            std::this_thread::yield();
+        }
+        accepted.fetch_add(1, std::memory_order_release);
+    }
+    // Blocks until every point accepted before the call is in the tree.
+    void flush() {
+        std::uint64_t target = accepted.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(signal);
+        while (done < target) {
+            wake = true;
+            wakeup.notify_one();
+            progress.wait_for(lock, options.commit_interval);
+        }
+    }
+    template <typename F>
+    auto read(F f) const {
+        if constexpr (Tree::Instrumentation::enabled) {
+            std::unique_lock<std::shared_mutex> lock(tree_lock);
+            return f(static_cast<const Tree&>(tree));
+        } else {
+            std::shared_lock<std::shared_mutex> lock(tree_lock);
+            return f(static_cast<const Tree&>(tree));
+        }
+    }
+    template <typename F>
+    auto write(F f) {
+        std::unique_lock<std::shared_mutex> lock(tree_lock);
+        return f(tree);
+    }
+    IngestStats stats() const {
+        IngestStats s;
+        {
+            std::lock_guard<std::mutex> lock(signal);
+            s = committed_stats;
+        }
+        s.accepted = accepted.load(std::memory_order_relaxed);
+        s.rejected = rejected.load(std::memory_order_relaxed);
+        s.elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return s;
+    }
+private:
+    Tree& tree;
+    IngestOptions options;
+    detail::BoundedQueue<Point> queue;
+    std::atomic<std::uint64_t> accepted;
+    std::atomic<std::uint64_t> rejected;
+    std::chrono::steady_clock::time_point started;
+    mutable std::shared_mutex tree_lock;
+    // signal guards stopping, wake, done and committed_stats.
+    mutable std::mutex signal;
+    std::condition_variable wakeup, progress;
+    bool stopping;
+    bool wake;
+    std::uint64_t done = 0;
+    IngestStats committed_stats;
+    std::thread worker;
+
+    // Runs before the queue and worker exist, so a throw leaves nothing behind.
+    static const IngestOptions& checked(const IngestOptions& o) {
+        if (o.queue_capacity == 0) {
+            throw std::invalid_argument("queue_capacity must be positive");
+        }
+        if (o.max_batch == 0) {
+            throw std::invalid_argument("max_batch must be positive");
+        }
+        if (o.commit_interval.count() <= 0) {
+            throw std::invalid_argument("commit_interval must be positive");
+        }
+        return o;
+    }
+    std::uint32_t zkey(const Point& p) const {
+        const auto& b = tree.bounds();
+        return detail::morton_key(detail::grid_cell(p.x, b.x, b.width), detail::grid_cell(p.y, b.y, b.height));
+    }
+    // Drains and commits up to max_batch points; returns how many it took.
+    std::size_t commit_batch(std::vector<std::pair<std::uint32_t, Point>>& batch) {
+        batch.clear();
+        Point p;
+        while (batch.size() < options.max_batch && queue.try_pop(p)) {
+            batch.emplace_back(zkey(p), p);
+        }
+        if (batch.empty()) {
+            return 0;
+        }
+        std::sort(batch.begin(), batch.end(), [](const std::pair<std::uint32_t, Point>& a, const std::pair<std::uint32_t, Point>& b) {
+            return a.first < b.first;
+        });
+        std::uint64_t inserted = 0;
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::shared_mutex> lock(tree_lock);
+            for (auto& entry : batch) {
+                inserted += tree.insert(entry.second);
+            }
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        {
+            std::lock_guard<std::mutex> lock(signal);
+            committed_stats.committed += inserted;
+            committed_stats.outside += batch.size() - inserted;
+            committed_stats.batches++;
+            committed_stats.commit_us_total += us;
+            committed_stats.commit_us_max = std::max(committed_stats.commit_us_max, us);
+            committed_stats.commit_us_last = us;
+            done += batch.size();
+        }
+        progress.notify_all();
+        return batch.size();
+    }
+    void run() {
+        std::vector<std::pair<std::uint32_t, Point>> batch;
+        batch.reserve(options.max_batch);
+        for (;;) {
+            bool last;
+            {
+                std::unique_lock<std::mutex> lock(signal);
+                wakeup.wait_for(lock, options.commit_interval, [this] { return stopping || wake; });
+                wake = false;
+                last = stopping;
+            }
+            while (commit_batch(batch) > 0) {
+            }
+            if (last) {
+                // Producers may still have been publishing when stop was
+                // requested; everything accepted so far must land.
+                while (done_count() < accepted.load(std::memory_order_acquire)) {
+                    if (commit_batch(batch) == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+                progress.notify_all();
+                return;
+            }
+        }
+    }
+    std::uint64_t done_count() const {
+        std::lock_guard<std::mutex> lock(signal);
+        return done;
+    }
+};
+
+}  // namespace terrain
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef TERRAIN_INSTRUMENTATION_H
+#define TERRAIN_INSTRUMENTATION_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace terrain {
+
+// Hot-path counters accumulated by an instrumented Quadtree.
+struct QuadtreeCounters {
+    std::uint64_t nodes_visited = 0;
+    std::uint64_t leaves_scanned = 0;
+    std::uint64_t points_tested = 0;
+    std::uint64_t points_returned = 0;
+    std::uint64_t subdivides = 0;
+    std::uint64_t compress_merges = 0;
+    std::uint64_t allocated_bytes = 0;
+
+    QuadtreeCounters operator-(const QuadtreeCounters& o) const {
+        QuadtreeCounters d;
+        d.nodes_visited = nodes_visited - o.nodes_visited;
+        d.leaves_scanned = leaves_scanned - o.leaves_scanned;
+        d.points_tested = points_tested - o.points_tested;
+        d.points_returned = points_returned - o.points_returned;
+        d.subdivides = subdivides - o.subdivides;
+        d.compress_merges = compress_merges - o.compress_merges;
+        d.allocated_bytes = allocated_bytes - o.allocated_bytes;
+        return d;
+    }
+    std::string to_json() const {
+        std::ostringstream out;
+        out << "{\"nodes_visited\":" << nodes_visited
+            << ",\"leaves_scanned\":" << leaves_scanned
+            << ",\"points_tested\":" << points_tested
+            << ",\"points_returned\":" << points_returned
+            << ",\"subdivides\":" << subdivides
+            << ",\"compress_merges\":" << compress_merges
+            << ",\"allocated_bytes\":" << allocated_bytes << "}";
+        return out.str();
+    }
+};
+
+// One traced top-level call: which operation, when, for how long, the window
+// it was asked about and what it cost in counter terms.
+struct TraceSpan {
+    std::string name;
+    double start_us;
+    double duration_us;
+    double x, y, width, height;
+    QuadtreeCounters cost;
+};
+
+// Collects spans from any number of trees; export as plain JSON or as a
+// Chrome trace (load in chrome://tracing or Perfetto).
+class TraceRecorder {
+public:
+    TraceRecorder() : epoch(std::chrono::steady_clock::now()) {}
+    double now_us() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+    }
+    void record(const TraceSpan& span) { recorded.push_back(span); }
+    const std::vector<TraceSpan>& spans() const { return recorded; }
+    void clear() { recorded.clear(); }
+    std::string to_json() const {
+        std::ostringstream out;
+        out << "[";
+        for (std::size_t i = 0; i < recorded.size(); i++) {
+            const TraceSpan& s = recorded[i];
+            out << (i ? "," : "") << "{\"name\":\"" << s.name << "\",\"start_us\":" << s.start_us
+                << ",\"duration_us\":" << s.duration_us << ",\"rect\":[" << s.x << "," << s.y << ","
+                << s.width << "," << s.height << "],\"cost\":" << s.cost.to_json() << "}";
+        }
+        out << "]";
+        return out.str();
+    }
+    std::string to_chrome_trace() const {
+        std::ostringstream out;
+        out << "{\"traceEvents\":[";
+        for (std::size_t i = 0; i < recorded.size(); i++) {
+            const TraceSpan& s = recorded[i];
+            out << (i ? "," : "") << "{\"name\":\"" << s.name << "\",\"cat\":\"quadtree\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+                << ",\"ts\":" << s.start_us << ",\"dur\":" << s.duration_us << ",\"args\":{\"rect\":[" << s.x << ","
+                << s.y << "," << s.width << "," << s.height << "],\"cost\":" << s.cost.to_json() << "}}";
+        }
+        out << "],\"displayTimeUnit\":\"ns\"}";
+        return out.str();
+    }
+    bool write_chrome_trace(const std::string& path) const {
+        std::ofstream file(path);
+        file << to_chrome_trace();
+        return static_cast<bool>(file);
+    }
+private:
+    std::chrono::steady_clock::time_point epoch;
+    std::vector<TraceSpan> recorded;
+};
+
+// Instrumentation hooks, chosen through QuadtreePolicy. The default has only
+// empty inline hooks and no state, so an uninstrumented tree compiles to the
+// same code and layout as before.
+struct NoInstrumentation {
+    static const bool enabled = false;
+    void on_node() {}
+    void on_leaf() {}
+    void on_point_tested() {}
+    void on_point_returned() {}
+    void on_subdivide() {}
+    void on_merge() {}
+    void on_allocate(std::size_t) {}
+};
+
+// Counts every hook into `counters`; when `trace` is set, each top-level
+// query, intersect, is_smooth and compress also records a span there. A tree
+// owns one of these at its root, so instrumented nodes stay small.
+struct CountingInstrumentation {
+    static const bool enabled = true;
+    QuadtreeCounters counters;
+    TraceRecorder* trace = nullptr;
+    void on_node() { counters.nodes_visited++; }
+    void on_leaf() { counters.leaves_scanned++; }
+    void on_point_tested() { counters.points_tested++; }
+    void on_point_returned() { counters.points_returned++; }
+    void on_subdivide() { counters.subdivides++; }
+    void on_merge() { counters.compress_merges++; }
+    void on_allocate(std::size_t bytes) { counters.allocated_bytes += bytes; }
+    void reset() { counters = QuadtreeCounters(); }
+};
+
+// RAII span around a top-level tree operation; a no-op unless the tree is
+// instrumented and has a recorder attached.
+template <typename Instrumentation>
+class TraceScope {
+public:
+    TraceScope(Instrumentation&, const char*, double, double, double, double) {}
+};
+
+template <>
+class TraceScope<CountingInstrumentation> {
+public:
+    TraceScope(CountingInstrumentation& in_, const char* name_, double x_, double y_, double w_, double h_)
+        : in(in_), name(name_), x(x_), y(y_), w(w_), h(h_), start(in_.trace ? in_.trace->now_us() : 0), before(in_.counters) {}
+    ~TraceScope() {
+        if (in.trace != nullptr) {
+            TraceSpan span{name, start, in.trace->now_us() - start, x, y, w, h, in.counters - before};
+            in.trace->record(span);
+        }
+    }
+private:
+    CountingInstrumentation& in;
+    const char* name;
+    double x, y, w, h;
+    double start;
+    QuadtreeCounters before;
+};
+
+}  // namespace terrain
+
+#endif
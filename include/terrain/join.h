@@ -0,0 +1,243 @@
+#ifndef TERRAIN_JOIN_H
+#define TERRAIN_JOIN_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace terrain {
+
+struct JoinOptions {
+    double tolerance = 1.0;    // max horizontal distance between matched points
+    int region_depth = 3;      // deltas are summed over a 2^d by 2^d grid, d in [0, 12]
+    bool keep_pairs = true;    // false: only per-region deltas are produced
+    unsigned threads = 0;      // 0 = hardware concurrency
+};
+
+// Elevation change (b - a) over the matches whose `a` point falls in grid
+// cell (x, y) of the first tree's bounds, rows running towards +y.
+struct RegionDelta {
+    int x, y;
+    std::size_t matches = 0;
+    double sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double mean() const { return matches ? sum / matches : 0; }
+};
+
+template <typename TreeA, typename TreeB>
+struct JoinResult {
+    struct Pair {
+        typename TreeA::Point a;
+        typename TreeB::Point b;
+        double distance;
+    };
+    std::vector<Pair> pairs;
+    std::vector<RegionDelta> regions;  // row-major, 2^region_depth per side
+    std::size_t matches = 0;
+};
+
+namespace detail {
+
+// Dual-tree traversal for spatial_join. Points live in internal nodes as well
+// as leaves, so join(A, B) splits the work into own(A) x sub(B), then
+// (sub(A) - own(A)) x own(B), then recurses on quadrant pairs; every pair of
+// points is considered exactly once and node pairs farther apart than the
+// tolerance are dropped whole.
+template <typename TreeA, typename TreeB>
+class DualTreeJoin {
+public:
+    typedef JoinResult<TreeA, TreeB> Result;
+    DualTreeJoin(const TreeA& a, const JoinOptions& options_) : options(options_), side(1 << checked_depth(options_.region_depth)) {
+        const auto& bounds = a.bounds();
+        minx = bounds.x - bounds.width;
+        miny = bounds.y - bounds.height;
+        cellw = 2 * bounds.width / side;
+        cellh = 2 * bounds.height / side;
+        regions.resize(static_cast<std::size_t>(side) * side);
+        for (int y = 0; y < side; y++) {
+            for (int x = 0; x < side; x++) {
+                regions[static_cast<std::size_t>(y) * side + x].x = x;
+                regions[static_cast<std::size_t>(y) * side + x].y = y;
+            }
+        }
+    }
+    std::vector<typename Result::Pair> pairs;
+    std::vector<RegionDelta> regions;
+    std::size_t matches = 0;
+
+    // Everything except the quadrant-pair recursion at this level.
+    void join_own(const TreeA* a, const TreeB* b) {
+        for (auto& p : a->node_points()) {
+            search_b(p, b);
+        }
+        if (a->is_divided()) {
+            for (auto& q : b->node_points()) {
+                for (int i = 0; i < 4; i++) {
+                    search_a(a->child(i), q);
+                }
+            }
+        }
+    }
+    void join(const TreeA* a, const TreeB* b) {
+        if (too_far(a, b)) {
+            return;
+        }
+        join_own(a, b);
+        if (a->is_divided() && b->is_divided()) {
+            for (int i = 0; i < 4; i++) {
+                for (int j = 0; j < 4; j++) {
+                    join(a->child(i), b->child(j));
+                }
+            }
+        }
+    }
+    void merge(DualTreeJoin& o) {
+        pairs.insert(pairs.end(), o.pairs.begin(), o.pairs.end());
+        matches += o.matches;
+        for (std::size_t i = 0; i < regions.size(); i++) {
+            regions[i].matches += o.regions[i].matches;
+            regions[i].sum += o.regions[i].sum;
+            regions[i].min = std::min(regions[i].min, o.regions[i].min);
+            regions[i].max = std::max(regions[i].max, o.regions[i].max);
+        }
+    }
+    template <typename NodeA, typename NodeB>
+    bool too_far(const NodeA* a, const NodeB* b) const {
+        const auto& ra = a->bounds();
+        const auto& rb = b->bounds();
+        double dx = std::max(0.0, std::abs(static_cast<double>(ra.x - rb.x)) - ra.width - rb.width);
+        double dy = std::max(0.0, std::abs(static_cast<double>(ra.y - rb.y)) - ra.height - rb.height);
+        return dx * dx + dy * dy > options.tolerance * options.tolerance;
+    }
+private:
+    const JoinOptions& options;
+    static int checked_depth(int depth) {
+        if (depth < 0 || depth > 12) {
+            throw std::invalid_argument("region_depth must be in [0, 12]");
+        }
+        return depth;
+    }
+    int side;
+    double minx, miny, cellw, cellh;
+
+    template <typename Node, typename P>
+    bool point_too_far(const Node* node, const P& p) const {
+        const auto& r = node->bounds();
+        double dx = std::max(0.0, std::abs(static_cast<double>(p.x - r.x)) - r.width);
+        double dy = std::max(0.0, std::abs(static_cast<double>(p.y - r.y)) - r.height);
+        return dx * dx + dy * dy > options.tolerance * options.tolerance;
+    }
+    void search_b(const typename TreeA::Point& p, const TreeB* b) {
+        if (point_too_far(b, p)) {
+            return;
+        }
+        for (auto& q : b->node_points()) {
+            emit(p, q);
+        }
+        if (b->is_divided()) {
+            for (int i = 0; i < 4; i++) {
+                search_b(p, b->child(i));
+            }
+        }
+    }
+    void search_a(const TreeA* a, const typename TreeB::Point& q) {
+        if (point_too_far(a, q)) {
+            return;
+        }
+        for (auto& p : a->node_points()) {
+            emit(p, q);
+        }
+        if (a->is_divided()) {
+            for (int i = 0; i < 4; i++) {
+                search_a(a->child(i), q);
+            }
+        }
+    }
+    void emit(const typename TreeA::Point& p, const typename TreeB::Point& q) {
+        double dx = static_cast<double>(q.x - p.x);
+        double dy = static_cast<double>(q.y - p.y);
+        double d2 = dx * dx + dy * dy;
+        if (d2 > options.tolerance * options.tolerance) {
+            return;
+        }
+        matches++;
+        double distance = std::sqrt(d2);
+        if (options.keep_pairs) {
+            pairs.push_back({p, q, distance});
+        }
+        int cx = std::min(side - 1, std::max(0, static_cast<int>((p.x - minx) / cellw)));
+        int cy = std::min(side - 1, std::max(0, static_cast<int>((p.y - miny) / cellh)));
+        RegionDelta& r = regions[static_cast<std::size_t>(cy) * side + cx];
+        double delta = static_cast<double>(q.elevation - p.elevation);
+        r.matches++;
+        r.sum += delta;
+        r.min = std::min(r.min, delta);
+        r.max = std::max(r.max, delta);
+    }
+};
+
+}  // namespace detail
+
+// Every pair (a, b) of points from the two trees within options.tolerance of
+// each other horizontally, plus elevation deltas summed per region. The two
+// roots' own points are matched first; the up to 16 surviving pairs of
+// top-level quadrants are then shared out to worker threads. Both trees are
+// only read and must not be modified meanwhile. Throws std::invalid_argument
+// for a region_depth outside [0, 12].
+template <typename TreeA, typename TreeB>
+JoinResult<TreeA, TreeB> spatial_join(const TreeA& a, const TreeB& b, const JoinOptions& options = JoinOptions()) {
+    typedef detail::DualTreeJoin<TreeA, TreeB> Join;
+    Join total(a, options);
+    if (total.too_far(&a, &b)) {
+        JoinResult<TreeA, TreeB> result;
+        result.regions = std::move(total.regions);
+        return result;
+    }
+    total.join_own(&a, &b);
+    std::vector<std::pair<const TreeA*, const TreeB*>> tasks;
+    if (a.is_divided() && b.is_divided()) {
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                if (!total.too_far(a.child(i), b.child(j))) {
+                    tasks.emplace_back(a.child(i), b.child(j));
+                }
+            }
+        }
+    }
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(tasks.size())));
+    std::vector<Join> partial(threads, Join(a, options));
+    std::atomic<std::size_t> next(0);
+    auto worker = [&](unsigned t) {
+        for (std::size_t i = next++; i < tasks.size(); i = next++) {
+            partial[t].join(tasks[i].first, tasks[i].second);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& th : pool) {
+        th.join();
+    }
+    for (auto& p : partial) {
+        total.merge(p);
+    }
+    JoinResult<TreeA, TreeB> result;
+    result.pairs = std::move(total.pairs);
+    result.regions = std::move(total.regions);
+    result.matches = total.matches;
+    return result;
+}
+
+}  // namespace terrain
+
+#endif
@@ -0,0 +1,361 @@
+#ifndef TERRAIN_LAYOUT_H
+#define TERRAIN_LAYOUT_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TERRAIN_LAYOUT_MMAP 1
+#endif
+
+#include "terrain/geometry.h"
+#include "terrain/morton.h"
+
+namespace terrain {
+
+// Order in which a serialized tree's node records, and the point blocks
+// they own, are laid out on disk.
+//   kDepthFirst  pre-order walk in the tree's NW, NE, SW, SE order, points as
+//                stored; what a plain dump of the tree gives.
+//   kZOrder      linear-quadtree order: nodes and points sorted by the Morton
+//                key of their position, ignoring the hierarchy.
+//   kHilbert     pre-order walk with children visited along the Hilbert
+//                curve, so consecutive subtrees are always spatial
+//                neighbours; points sorted along the curve too.
+enum class NodeOrder : std::uint32_t {
+    kDepthFirst = 0,
+    kZOrder = 1,
+    kHilbert = 2
+};
+
+// File format, page aligned and in the writer's native byte order (a reader
+// of the other endianness sees a bad version and rejects the file):
+//   LayoutHeader | LayoutNode[node_count] | LayoutPoint[point_count]
+struct LayoutHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t order;
+    std::uint64_t node_count;
+    std::uint64_t point_count;
+    std::uint64_t root;
+    std::uint64_t nodes_offset;
+    std::uint64_t points_offset;
+};
+
+struct LayoutNode {
+    double x, y, width, height;   // centre and half-extents, as in Rectangle
+    double max_z;
+    std::uint64_t first_point;
+    std::uint32_t point_count;
+    std::uint32_t children[4];    // NW, NE, SW, SE; kNoChild for a leaf
+};
+
+struct LayoutPoint {
+    double x, y, elevation;
+};
+
+const std::uint32_t kNoChild = std::numeric_limits<std::uint32_t>::max();
+const std::size_t kLayoutPage = 4096;
+
+namespace detail {
+
+// Distance along the Hilbert curve filling a 65536 x 65536 grid.
+inline std::uint32_t hilbert_key(std::uint32_t x, std::uint32_t y) {
+    std::uint32_t d = 0;
+    for (std::uint32_t s = 1u << 15; s > 0; s >>= 1) {
+        std::uint32_t rx = (x & s) ? 1 : 0;
+        std::uint32_t ry = (y & s) ? 1 : 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+inline std::size_t page_align(std::size_t n) {
+    return (n + kLayoutPage - 1) / kLayoutPage * kLayoutPage;
+}
+
+}  // namespace detail
+
+// Writes `tree` to `path` with its nodes in `order`; points inside each node
+// follow the same curve. Returns false if the file could not be written.
+template <typename Tree>
+bool write_layout(const Tree& tree, const std::string& path, NodeOrder order) {
+    // Pre-order walk; each entry remembers its parent and quadrant so the
+    // parent's child links can be filled in as the children are reached.
+    struct Pending {
+        const Tree* node;
+        std::size_t parent;
+        int quadrant;
+        int depth;
+    };
+    std::vector<const Tree*> nodes;
+    std::vector<int> depth;
+    std::vector<std::array<std::size_t, 4>> kids;
+    std::vector<Pending> stack{{&tree, 0, -1, 0}};
+    while (!stack.empty()) {
+        Pending top = stack.back();
+        stack.pop_back();
+        std::size_t i = nodes.size();
+        nodes.push_back(top.node);
+        depth.push_back(top.depth);
+        kids.push_back({{0, 0, 0, 0}});
+        if (top.quadrant >= 0) {
+            kids[top.parent][top.quadrant] = i;
+        }
+        if (top.node->is_divided()) {
+            for (int q = 3; q >= 0; q--) {
+                stack.push_back({top.node->child(q), i, q, top.depth + 1});
+            }
+        }
+    }
+    const auto& root = tree.bounds();
+    auto key = [&](double x, double y) {
+        std::uint32_t cx = detail::grid_cell(x, root.x, root.width);
+        std::uint32_t cy = detail::grid_cell(y, root.y, root.height);
+        return order == NodeOrder::kHilbert ? detail::hilbert_key(cx, cy) : detail::morton_key(cx, cy);
+    };
+
+    std::vector<std::size_t> rank(nodes.size());
+    std::iota(rank.begin(), rank.end(), 0);
+    if (order != NodeOrder::kDepthFirst) {
+        std::vector<std::uint32_t> keys(nodes.size());
+        for (std::size_t i = 0; i < nodes.size(); i++) {
+            keys[i] = key(nodes[i]->bounds().x, nodes[i]->bounds().y);
+        }
+        if (order == NodeOrder::kHilbert) {
+            // A depth-d subtree covers one aligned run of 4^(16-d) curve
+            // cells; keying each node by the start of its run keeps subtrees
+            // contiguous, i.e. a pre-order walk in Hilbert child order.
+            for (std::size_t i = 0; i < nodes.size(); i++) {
+                int shift = 2 * std::max(0, 16 - depth[i]);
+                keys[i] = shift >= 32 ? 0 : keys[i] >> shift << shift;
+            }
+        }
+        std::stable_sort(rank.begin(), rank.end(), [&](std::size_t a, std::size_t b) {
+            return keys[a] != keys[b] ? keys[a] < keys[b] : depth[a] < depth[b];
+        });
+    }
+    std::vector<std::uint32_t> slot(nodes.size());
+    for (std::size_t i = 0; i < rank.size(); i++) {
+        slot[rank[i]] = static_cast<std::uint32_t>(i);
+    }
+    std::vector<LayoutNode> records(nodes.size());
+    std::vector<LayoutPoint> points;
+    std::vector<std::pair<std::uint32_t, LayoutPoint>> block;
+    for (std::size_t i = 0; i < rank.size(); i++) {
+        const Tree* node = nodes[rank[i]];
+        LayoutNode& rec = records[i];
+        rec.x = node->bounds().x;
+        rec.y = node->bounds().y;
+        rec.width = node->bounds().width;
+        rec.height = node->bounds().height;
+        rec.max_z = node->max_elevation();
+        rec.first_point = points.size();
+        rec.point_count = static_cast<std::uint32_t>(node->node_points().size());
+        for (int q = 0; q < 4; q++) {
+            rec.children[q] = node->is_divided() ? slot[kids[rank[i]][q]] : kNoChild;
+        }
+        block.clear();
+        for (auto& p : node->node_points()) {
+            LayoutPoint lp{static_cast<double>(p.x), static_cast<double>(p.y), static_cast<double>(p.elevation)};
+            block.emplace_back(order == NodeOrder::kDepthFirst ? 0 : key(lp.x, lp.y), lp);
+        }
+        std::stable_sort(block.begin(), block.end(), [](const std::pair<std::uint32_t, LayoutPoint>& a, const std::pair<std::uint32_t, LayoutPoint>& b) {
+            return a.first < b.first;
+        });
+        for (auto& entry : block) {
+            points.push_back(entry.second);
+        }
+    }
+
+    LayoutHeader header;
+    std::memcpy(header.magic, "TQLAYOUT", 8);
+    header.version = 1;
+    header.order = static_cast<std::uint32_t>(order);
+    header.node_count = records.size();
+    header.point_count = points.size();
+    header.root = slot[0];
+    header.nodes_offset = kLayoutPage;
+    header.points_offset = detail::page_align(header.nodes_offset + records.size() * sizeof(LayoutNode));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    std::vector<char> pad(kLayoutPage, 0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(pad.data(), header.nodes_offset - sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(LayoutNode));
+    file.write(pad.data(), header.points_offset - header.nodes_offset - records.size() * sizeof(LayoutNode));
+    file.write(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(LayoutPoint));
+    return static_cast<bool>(file);
+}
+
+// Read-only view of a file written by write_layout, memory-mapped where the
+// platform allows so that queries page in only what they touch. Throws
+// std::runtime_error if the file is missing or malformed.
+class MappedLayout {
+public:
+    typedef BasicPoint<double, double> Point;
+    typedef BasicRectangle<double> Rectangle;
+
+    explicit MappedLayout(const std::string& path) {
+#ifdef TERRAIN_LAYOUT_MMAP
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open layout " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(LayoutHeader))) {
+            ::close(fd);
+            throw std::runtime_error("layout too short: " + path);
+        }
+        size = static_cast<std::size_t>(st.st_size);
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("cannot map layout " + path);
+        }
+        base = static_cast<const char*>(p);
+        // Queries jump around the file; readahead would only blur which
+        // pages a query really needs.
+        ::madvise(p, size, MADV_RANDOM);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("cannot open layout " + path);
+        }
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        size = buffer.size();
+        base = buffer.data();
+#endif
+        std::memcpy(&header, base, std::min(size, sizeof(header)));
+        if (size < sizeof(header) || std::memcmp(header.magic, "TQLAYOUT", 8) != 0 || header.version != 1 ||
+            !fits(header.nodes_offset, header.node_count, sizeof(LayoutNode), alignof(LayoutNode)) ||
+            !fits(header.points_offset, header.point_count, sizeof(LayoutPoint), alignof(LayoutPoint)) || header.root >= header.node_count) {
+            release();
+            throw std::runtime_error("not a terrain layout: " + path);
+        }
+        nodes = reinterpret_cast<const LayoutNode*>(base + header.nodes_offset);
+        points = reinterpret_cast<const LayoutPoint*>(base + header.points_offset);
+        if (!well_formed()) {
+            release();
+            throw std::runtime_error("corrupt terrain layout: " + path);
+        }
+    }
+    MappedLayout(const MappedLayout&) = delete;
+    MappedLayout& operator=(const MappedLayout&) = delete;
+    ~MappedLayout() { release(); }
+
+    NodeOrder order() const { return static_cast<NodeOrder>(header.order); }
+    std::size_t node_count() const { return header.node_count; }
+    std::size_t point_count() const { return header.point_count; }
+    std::size_t file_bytes() const { return size; }
+
+    void query(Rectangle range, std::vector<Point>& found) const {
+        query(header.root, range, found);
+    }
+    // Asks the OS to drop this file's pages from the mapping and the page
+    // cache, so the next query runs cold. Best effort; a no-op without mmap.
+    void drop_cache() const {
+#ifdef TERRAIN_LAYOUT_MMAP
+        ::madvise(const_cast<char*>(base), size, MADV_DONTNEED);
+#ifdef POSIX_FADV_DONTNEED
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+#endif
+    }
+private:
+    LayoutHeader header;
+    const char* base = nullptr;
+    std::size_t size = 0;
+    const LayoutNode* nodes = nullptr;
+    const LayoutPoint* points = nullptr;
+#ifdef TERRAIN_LAYOUT_MMAP
+    int fd = -1;
+#else
+    std::vector<char> buffer;
+#endif
+
+    void release() {
+#ifdef TERRAIN_LAYOUT_MMAP
+        if (base != nullptr) {
+            ::munmap(const_cast<char*>(base), size);
+            base = nullptr;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+#endif
+    }
+    // Whether count records of the given size start at an aligned offset
+    // and end inside the file, without overflowing on hostile counts.
+    bool fits(std::uint64_t offset, std::uint64_t count, std::size_t record, std::size_t align) const {
+        return offset % align == 0 && offset <= size && count <= (size - offset) / record;
+    }
+    // Every point block lies inside the point section and the child links
+    // form a tree under the root: each node has at most one parent and the
+    // root has none, so query() can trust the records and never loops.
+    bool well_formed() const {
+        std::vector<bool> has_parent(header.node_count, false);
+        for (std::uint64_t i = 0; i < header.node_count; i++) {
+            const LayoutNode& node = nodes[i];
+            if (node.first_point > header.point_count || node.point_count > header.point_count - node.first_point) {
+                return false;
+            }
+            if (node.children[0] == kNoChild) {
+                if (node.children[1] != kNoChild || node.children[2] != kNoChild || node.children[3] != kNoChild) {
+                    return false;
+                }
+                continue;
+            }
+            for (std::uint32_t child : node.children) {
+                if (child >= header.node_count || child == header.root || has_parent[child]) {
+                    return false;
+                }
+                has_parent[child] = true;
+            }
+        }
+        return true;
+    }
+    void query(std::uint64_t i, const Rectangle& range, std::vector<Point>& found) const {
+        const LayoutNode& node = nodes[i];
+        if (!Rectangle(node.x, node.y, node.width, node.height).intersects(range)) {
+            return;
+        }
+        const LayoutPoint* p = points + node.first_point;
+        for (std::uint32_t k = 0; k < node.point_count; k++) {
+            if (range.contains(p[k])) {
+                found.push_back(Point(p[k].x, p[k].y, p[k].elevation));
+            }
+        }
+        if (node.children[0] != kNoChild) {
+            for (int q = 0; q < 4; q++) {
+                query(node.children[q], range, found);
+            }
+        }
+    }
+};
+
+}  // namespace terrain
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef TERRAIN_LEAF_BUFFER_H
+#define TERRAIN_LEAF_BUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace terrain {
+
+// Leaf point storage. Holds up to N points inline so leaves never touch the
+// heap; only leaves pinned at the depth limit (or kept whole by an
+// error-driven split rule) spill past N into a vector.
+template <typename T, std::size_t N>
+class LeafBuffer {
+public:
+    LeafBuffer() : count(0) {}
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    // Bytes reserved on the heap for spilled points.
+    std::size_t heap_bytes() const { return spill.capacity() * sizeof(T); }
+    void push_back(const T& value) {
+        if (count < N && spill.empty()) {
+            items[count++] = value;
+            return;
+        }
+        if (spill.empty()) {
+            spill.assign(items, items + count);
+        }
+        spill.push_back(value);
+        count++;
+    }
+    // Points that fit without spilling.
+    static std::size_t inline_capacity() { return N; }
+    bool spilled() const { return !spill.empty(); }
+    // Releases spare spill capacity, moving the points back inline when
+    // they fit there again.
+    void shrink_to_fit() {
+        if (spill.empty()) {
+            return;
+        }
+        if (count <= N) {
+            std::copy(spill.begin(), spill.end(), items);
+            std::vector<T>().swap(spill);
+        } else {
+            spill.shrink_to_fit();
+        }
+    }
+    void clear() {
+        std::vector<T>().swap(spill);
+        count = 0;
+    }
+    T* begin() { return spill.empty() ? items : spill.data(); }
+    T* end() { return begin() + count; }
+    const T* begin() const { return spill.empty() ? items : spill.data(); }
+    const T* end() const { return begin() + count; }
+private:
+    T items[N];
+    std::vector<T> spill;
+    std::size_t count;
+};
+
+}  // namespace terrain
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef TERRAIN_MEMORY_REPORT_H
+#define TERRAIN_MEMORY_REPORT_H
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace terrain {
+
+// Where a tree's memory goes, from Quadtree::memory_report(). Every node is
+// one allocation of node_size bytes holding its bounds, child pointers and
+// bookkeeping (structure) plus an inline array of leaf_capacity points; the
+// used part of that array, or of a spilled vector, is payload and the rest
+// is slack. Inline slack only shrinks with a smaller policy capacity.
+// Allocator headers are not included.
+struct MemoryReport {
+    std::size_t node_size = 0;
+    std::size_t leaf_capacity = 0;
+    std::size_t nodes = 0;
+    std::size_t leaves = 0;
+    std::size_t empty_leaves = 0;
+    std::size_t spilled_nodes = 0;     // nodes whose points moved to the heap
+    std::size_t points = 0;
+    std::vector<std::size_t> nodes_by_depth;
+    // leaf_fill[k] counts leaves holding k points; the last bucket counts
+    // leaves holding more than leaf_capacity.
+    std::vector<std::size_t> leaf_fill;
+    std::size_t structure_bytes = 0;
+    std::size_t payload_bytes = 0;
+    std::size_t slack_bytes = 0;       // unused inline slots and spill capacity
+    std::size_t spill_slack_bytes = 0; // the part of slack shrink_to_fit() can free
+    std::size_t heap_bytes = 0;        // spilled vectors, payload and slack alike
+
+    std::size_t total_bytes() const { return structure_bytes + payload_bytes + slack_bytes; }
+    std::string to_json() const {
+        std::ostringstream out;
+        out << "{\"node_size\":" << node_size << ",\"leaf_capacity\":" << leaf_capacity << ",\"nodes\":" << nodes
+            << ",\"leaves\":" << leaves << ",\"empty_leaves\":" << empty_leaves << ",\"spilled_nodes\":" << spilled_nodes
+            << ",\"points\":" << points << ",\"nodes_by_depth\":" << list(nodes_by_depth) << ",\"leaf_fill\":" << list(leaf_fill)
+            << ",\"structure_bytes\":" << structure_bytes << ",\"payload_bytes\":" << payload_bytes
+            << ",\"slack_bytes\":" << slack_bytes << ",\"spill_slack_bytes\":" << spill_slack_bytes << ",\"heap_bytes\":" << heap_bytes << ",\"total_bytes\":" << total_bytes() << "}";
+        return out.str();
+    }
+private:
+    static std::string list(const std::vector<std::size_t>& values) {
+        std::ostringstream out;
+        out << "[";
+        for (std::size_t i = 0; i < values.size(); i++) {
+            out << (i ? "," : "") << values[i];
+        }
+        out << "]";
+        return out.str();
+    }
+};
+
+}  // namespace terrain
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef TERRAIN_MORTON_H
+#define TERRAIN_MORTON_H
+
+#include <algorithm>
+#include <cstdint>
+
+namespace terrain {
+
+namespace detail {
+
+// Z-order (Morton) keys over a 65536 x 65536 grid, shared by ingest batching,
+// tile encoding and the serialized layout.
+const double kGridCells = 65536.0;
+
+// Grid column (or row) of coordinate v within the extent centre +- half,
+// clamped to [0, 65535] so points on or past the far edge stay on the grid.
+inline std::uint32_t grid_cell(double v, double centre, double half) {
+    double f = (v - (centre - half)) / (2 * half);
+    return static_cast<std::uint32_t>(std::min(kGridCells - 1, std::max(0.0, f * kGridCells)));
+}
+
+// Spreads the low 16 bits of v to the even bit positions.
+inline std::uint32_t spread_bits(std::uint32_t v) {
+    v &= 0xffff;
+    v = (v | (v << 8)) & 0x00ff00ff;
+    v = (v | (v << 4)) & 0x0f0f0f0f;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+// Interleaves x into the even bits and y into the odd bits, so sorting by key
+// visits quadrants in NW, NE, SW, SE order at every level.
+inline std::uint32_t morton_key(std::uint32_t x, std::uint32_t y) {
+    return spread_bits(x) | (spread_bits(y) << 1);
+}
+
+}  // namespace detail
+
+}  // namespace terrain
+
+#endif
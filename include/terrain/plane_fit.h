@@ -0,0 +1,69 @@
+#ifndef TERRAIN_PLANE_FIT_H
+#define TERRAIN_PLANE_FIT_H
+
+#include <algorithm>
+#include <cmath>
+
+namespace terrain {
+
+// Running least-squares fit of the plane z = a + b*x + c*y over a node's
+// points. Only the moments are kept, taken about the node's centre, so adding
+// a point or folding a child's fit into its parent is O(1).
+class PlaneFit {
+public:
+    double n, sx, sy, sz, sxx, sxy, syy, sxz, syz, szz;
+    PlaneFit() : n(0), sx(0), sy(0), sz(0), sxx(0), sxy(0), syy(0), sxz(0), syz(0), szz(0) {}
+    void add(double dx, double dy, double z) {
+        n += 1;
+        sx += dx;
+        sy += dy;
+        sz += z;
+        sxx += dx * dx;
+        sxy += dx * dy;
+        syy += dy * dy;
+        sxz += dx * z;
+        syz += dy * z;
+        szz += z * z;
+    }
+    // Folds in a fit whose centre lies (tx, ty) away from this one's.
+    void merge(const PlaneFit& o, double tx, double ty) {
+        n += o.n;
+        sx += o.sx + o.n * tx;
+        sy += o.sy + o.n * ty;
+        sz += o.sz;
+        sxx += o.sxx + 2 * tx * o.sx + o.n * tx * tx;
+        sxy += o.sxy + tx * o.sy + ty * o.sx + o.n * tx * ty;
+        syy += o.syy + 2 * ty * o.sy + o.n * ty * ty;
+        sxz += o.sxz + tx * o.sz;
+        syz += o.syz + ty * o.sz;
+        szz += o.szz;
+    }
+    // Root-mean-square elevation residual of the best plane. Falls back to a
+    // flat (mean) fit when the points are too few or collinear.
+    double rms_error() const {
+        if (n == 0) {
+            return 0;
+        }
+        double sse = szz - sz * sz / n;
+        double det = n * (sxx * syy - sxy * sxy) - sx * (sx * syy - sxy * sy) + sy * (sx * sxy - sxx * sy);
+        if (n >= 3 && std::fabs(det) > 1e-12 * (sxx * syy + 1)) {
+            double a = (sz * (sxx * syy - sxy * sxy) - sx * (sxz * syy - sxy * syz) + sy * (sxz * sxy - sxx * syz)) / det;
+            double b = (n * (sxz * syy - sxy * syz) - sz * (sx * syy - sxy * sy) + sy * (sx * syz - sxz * sy)) / det;
+            double c = (n * (sxx * syz - sxz * sxy) - sx * (sx * syz - sxz * sy) + sz * (sx * sxy - sxx * sy)) / det;
+            sse = szz - (a * sz + b * sxz + c * syz);
+        }
+        return std::sqrt(std::max(sse, 0.0) / n);
+    }
+};
+
+// Stand-in for PlaneFit under split rules that never look at elevations;
+// empty, so a [[no_unique_address]] member of this type costs nothing.
+struct NoFit {
+    void add(double, double, double) {}
+    void merge(const NoFit&, double, double) {}
+    double rms_error() const { return 0; }
+};
+
+}  // namespace terrain
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TERRAIN_POLICY_H
+#define TERRAIN_POLICY_H
+
+#include <cstddef>
+
+#include "terrain/instrumentation.h"
+#include "terrain/plane_fit.h"
+
+namespace terrain {
+
+// Split rules. CountSplit is the classic "split a leaf once it is full".
+// ElevationErrorSplit only splits a full leaf when a plane no longer
+// describes its elevations within the tree's tolerance, so flat ground stays
+// in a few large leaves, and lets compress() fold siblings back together
+// whenever one plane would do. fit_type is what each node keeps for the rule;
+// can_merge is given the number of points the four leaf quadrants would fold
+// into their parent, and the fit of parent and quadrants together.
+struct CountSplit {
+    static const bool uses_fit = false;
+    typedef NoFit fit_type;
+    static bool should_split(std::size_t size, std::size_t capacity, const NoFit&, double) {
+        return size >= capacity;
+    }
+    static bool can_merge(std::size_t size, std::size_t capacity, const NoFit&, double) {
+        return size <= capacity;
+    }
+};
+
+// A leaf still splits once it holds max_fill times the capacity however well
+// its plane fits, so a scan of flat ground stays bounded.
+struct ElevationErrorSplit {
+    static const bool uses_fit = true;
+    static const std::size_t max_fill = 4;
+    typedef PlaneFit fit_type;
+    static bool should_split(std::size_t size, std::size_t capacity, const PlaneFit& fit, double tolerance) {
+        return size >= capacity && (size >= max_fill * capacity || fit.rms_error() > tolerance);
+    }
+    static bool can_merge(std::size_t size, std::size_t capacity, const PlaneFit& fit, double tolerance) {
+        return size <= max_fill * capacity && fit.rms_error() <= tolerance;
+    }
+};
+
+// Compile-time knobs for a Quadtree: leaf capacity, maximum depth, coordinate
+// type, payload (elevation) type, split rule and instrumentation hooks.
+template <typename Coord, typename Payload, std::size_t Capacity, int MaxDepth, typename Split = CountSplit, typename Instrumentation = NoInstrumentation>
+struct QuadtreePolicy {
+    typedef Coord coord_type;
+    typedef Payload payload_type;
+    typedef Split split_rule;
+    typedef Instrumentation instrumentation;
+    static const std::size_t capacity = Capacity;
+    static const int max_depth = MaxDepth;
+};
+typedef QuadtreePolicy<double, double, 16, 16> DefaultPolicy;
+typedef QuadtreePolicy<double, double, 16, 16, ElevationErrorSplit> AdaptivePolicy;
+typedef QuadtreePolicy<double, double, 16, 16, CountSplit, CountingInstrumentation> InstrumentedPolicy;
+
+}  // namespace terrain
+
+#endif
@@ -0,0 +1,517 @@
+#ifndef TERRAIN_QUADTREE_H
+#define TERRAIN_QUADTREE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "terrain/geometry.h"
+#include "terrain/instrumentation.h"
+#include "terrain/leaf_buffer.h"
+#include "terrain/memory_report.h"
+#include "terrain/plane_fit.h"
+#include "terrain/policy.h"
+#include "terrain/region.h"
+#include "terrain/sight_line.h"
+
+namespace terrain {
+
+// Point quadtree over elevation samples. A node keeps its own points until the
+// policy's split rule pushes further inserts down into four quadrants, and
+// compress() folds leaf quadrants back into their parent when the rule allows.
+//
+// Instrumentation hooks always report into the root's instrumentation object,
+// which the recursive helpers below thread through as `in`; the split rule's
+// tolerance is likewise only read from the root and passed down as `tol`.
+template <typename Policy = DefaultPolicy>
+class Quadtree {
+public:
+    typedef typename Policy::coord_type coord_type;
+    typedef BasicPoint<coord_type, typename Policy::payload_type> Point;
+    typedef BasicRectangle<coord_type> Rectangle;
+    typedef typename Policy::split_rule Split;
+    typedef typename Policy::instrumentation Instrumentation;
+    typedef typename Split::fit_type Fit;
+    static_assert(Policy::capacity > 0, "leaf capacity must be positive");
+private:
+    // Count-based rules need neither a plane fit nor a tolerance, so both
+    // collapse to empty members.
+    struct NoTolerance {
+        NoTolerance(double) {}
+        operator double() const { return 0; }
+    };
+    typedef std::conditional_t<Split::uses_fit, double, NoTolerance> Tolerance;
+    // Instrumented trees keep one hooks object, owned by the root; every other
+    // node holds a null handle. Uninstrumented hooks are empty and held inline.
+    typedef std::conditional_t<Instrumentation::enabled, std::unique_ptr<Instrumentation>, Instrumentation> Hooks;
+
+    Rectangle boundary;
+    LeafBuffer<Point, Policy::capacity> points;
+    [[no_unique_address]] Fit fit;
+    Quadtree *northwest, *northeast, *southwest, *southeast;
+    double max_z;
+    std::size_t total;
+    [[no_unique_address]] Tolerance tolerance;  // set on the root only
+    int depth;
+    bool divided;
+    [[no_unique_address]] mutable Hooks hooks;  // set on the root only
+
+    static Hooks make_hooks() {
+        if constexpr (Instrumentation::enabled) {
+            return std::make_unique<Instrumentation>();
+        } else {
+            return Hooks();
+        }
+    }
+    Instrumentation& instr() const {
+        if constexpr (Instrumentation::enabled) {
+            return *hooks;
+        } else {
+            return hooks;
+        }
+    }
+
+    Quadtree(Rectangle boundary_, const Quadtree& parent) : boundary(boundary_), points(), fit(), northwest(nullptr), northeast(nullptr), southwest(nullptr), southeast(nullptr), max_z(-std::numeric_limits<double>::infinity()), total(0), tolerance(0), depth(parent.depth + 1), divided(false) {}
+    bool wants_split(const Point& p, double tol) const {
+        Fit next = fit;
+        next.add(p.x - boundary.x, p.y - boundary.y, p.elevation);
+        return Split::should_split(points.size(), Policy::capacity, next, tol);
+    }
+    bool insert(Point p, double tol, Instrumentation& in) {
+        if (!boundary.contains(p)) {
+            return false;
+        }
+        if (p.elevation > max_z) {
+            max_z = p.elevation;
+        }
+        if (!divided && (depth >= Policy::max_depth || !wants_split(p, tol))) {
+            std::size_t heap_before = Instrumentation::enabled ? points.heap_bytes() : 0;
+            points.push_back(p);
+            if (Instrumentation::enabled && points.heap_bytes() > heap_before) {
+                in.on_allocate(points.heap_bytes() - heap_before);
+            }
+            fit.add(p.x - boundary.x, p.y - boundary.y, p.elevation);
+            total++;
+            return true;
+        }
+        if (!divided) {
+            subdivide(in);
+        }
+        bool stored = northwest->insert(p, tol, in) || northeast->insert(p, tol, in) || southwest->insert(p, tol, in) || southeast->insert(p, tol, in);
+        if (stored) {
+            total++;
+        }
+        return stored;
+    }
+    void subdivide(Instrumentation& in) {
+        coord_type x = boundary.x;
+        coord_type y = boundary.y;
+        coord_type w = boundary.width / 2;
+        coord_type h = boundary.height / 2;
+        Rectangle nw(x - w, y - h, w, h);
+        northwest = new Quadtree(nw, *this);
+        Rectangle ne(x + w, y - h, w, h);
+        northeast = new Quadtree(ne, *this);
+        Rectangle sw(x - w, y + h, w, h);
+        southwest = new Quadtree(sw, *this);
+        Rectangle se(x + w, y + h, w, h);
+        southeast = new Quadtree(se, *this);
+        divided = true;
+        in.on_subdivide();
+        in.on_allocate(4 * sizeof(Quadtree));
+    }
+    template <typename OnMerge>
+    void compress(double tol, Instrumentation& in, OnMerge& merged_into) {
+        if (!divided) {
+            return;
+        }
+        for (auto& child : { northwest, northeast, southwest, southeast }) {
+            child->compress(tol, in, merged_into);
+        }
+        if (northwest->divided || northeast->divided || southwest->divided || southeast->divided) {
+            return;
+        }
+        // A node only splits once its own buffer is full, so the rule is
+        // asked about what its quadrants would add back.
+        std::size_t merged_size = 0;
+        Fit merged = fit;
+        for (auto& child : { northwest, northeast, southwest, southeast }) {
+            merged_size += child->points.size();
+            merged.merge(child->fit, child->boundary.x - boundary.x, child->boundary.y - boundary.y);
+        }
+        if (Split::can_merge(merged_size, Policy::capacity, merged, tol)) {
+            for (auto& child : { northwest, northeast, southwest, southeast }) {
+                for (auto& point : child->points) {
+                    points.push_back(point);
+                }
+                delete child;
+            }
+            northwest = northeast = southwest = southeast = nullptr;
+            fit = merged;
+            divided = false;
+            in.on_merge();
+            merged_into(static_cast<const Rectangle&>(boundary));
+        }
+    }
+    void account(MemoryReport& report) const {
+        if (report.nodes_by_depth.size() <= static_cast<std::size_t>(depth)) {
+            report.nodes_by_depth.resize(depth + 1);
+        }
+        report.nodes_by_depth[depth]++;
+        report.nodes++;
+        report.points += points.size();
+        std::size_t inline_bytes = Policy::capacity * sizeof(Point);
+        report.structure_bytes += sizeof(Quadtree) - inline_bytes;
+        report.payload_bytes += points.size() * sizeof(Point);
+        report.slack_bytes += inline_bytes + points.heap_bytes() - points.size() * sizeof(Point);
+        report.heap_bytes += points.heap_bytes();
+        if (points.spilled()) {
+            report.spill_slack_bytes += points.heap_bytes() - points.size() * sizeof(Point);
+        }
+        report.spilled_nodes += points.spilled();
+        if (divided) {
+            for (auto& child : { northwest, northeast, southwest, southeast }) {
+                child->account(report);
+            }
+            return;
+        }
+        report.leaves++;
+        report.empty_leaves += points.empty();
+        report.leaf_fill[std::min(points.size(), static_cast<std::size_t>(Policy::capacity) + 1)]++;
+    }
+    // Returns the bytes released.
+    std::size_t shrink_to_fit_nodes() {
+        std::size_t freed = points.heap_bytes();
+        points.shrink_to_fit();
+        freed -= points.heap_bytes();
+        if (!divided) {
+            return freed;
+        }
+        if (total == points.size()) {
+            // Nothing below this node: drop the empty quadrants.
+            for (auto& child : { northwest, northeast, southwest, southeast }) {
+                freed += child->subtree_bytes();
+                delete child;
+            }
+            northwest = northeast = southwest = southeast = nullptr;
+            divided = false;
+            return freed;
+        }
+        for (auto& child : { northwest, northeast, southwest, southeast }) {
+            freed += child->shrink_to_fit_nodes();
+        }
+        return freed;
+    }
+    std::size_t subtree_bytes() const {
+        std::size_t bytes = sizeof(Quadtree) + points.heap_bytes();
+        if (divided) {
+            for (auto& child : { northwest, northeast, southwest, southeast }) {
+                bytes += child->subtree_bytes();
+            }
+        }
+        return bytes;
+    }
+    // Scans this node's own points into found; shared by query and intersect.
+    void scan(const Rectangle& range, std::vector<Point>& found, Instrumentation& in) const {
+        in.on_node();
+        if (!divided) {
+            in.on_leaf();
+        }
+        for (auto& p : points) {
+            in.on_point_tested();
+            if (range.contains(p)) {
+                in.on_point_returned();
+                found.push_back(p);
+            }
+        }
+    }
+    void query(const Rectangle& range, std::vector<Point>& found, Instrumentation& in) const {
+        if (!boundary.intersects(range)) {
+            return;
+        }
+        scan(range, found, in);
+        if (divided) {
+            northwest->query(range, found, in);
+            northeast->query(range, found, in);
+            southwest->query(range, found, in);
+            southeast->query(range, found, in);
+        }
+    }
+    // Appends every point in this subtree without testing any of them.
+    void collect(std::vector<Point>& found, Instrumentation& in) const {
+        in.on_node();
+        for (auto& p : points) {
+            in.on_point_returned();
+            found.push_back(p);
+        }
+        if (divided) {
+            northwest->collect(found, in);
+            northeast->collect(found, in);
+            southwest->collect(found, in);
+            southeast->collect(found, in);
+        }
+    }
+    // Region is a Polygon or Corridor: subtrees it covers are collected whole,
+    // subtrees it misses are skipped, and only crossing nodes test points.
+    template <typename Region>
+    void query_region(const Region& region, std::vector<Point>& found, Instrumentation& in) const {
+        Coverage c = region.classify(boundary.x - boundary.width, boundary.y - boundary.height, boundary.x + boundary.width, boundary.y + boundary.height);
+        if (c == Coverage::kOutside) {
+            return;
+        }
+        if (c == Coverage::kInside) {
+            collect(found, in);
+            return;
+        }
+        in.on_node();
+        if (!divided) {
+            in.on_leaf();
+        }
+        for (auto& p : points) {
+            in.on_point_tested();
+            if (region.contains(p.x, p.y)) {
+                in.on_point_returned();
+                found.push_back(p);
+            }
+        }
+        if (divided) {
+            northwest->query_region(region, found, in);
+            northeast->query_region(region, found, in);
+            southwest->query_region(region, found, in);
+            southeast->query_region(region, found, in);
+        }
+    }
+    // Nodes the range covers answer from their subtree count alone.
+    std::size_t count(const Rectangle& range, Instrumentation& in) const {
+        if (!boundary.intersects(range)) {
+            return 0;
+        }
+        in.on_node();
+        if (range.covers(boundary)) {
+            return total;
+        }
+        if (!divided) {
+            in.on_leaf();
+        }
+        std::size_t n = 0;
+        for (auto& p : points) {
+            in.on_point_tested();
+            n += range.contains(p);
+        }
+        if (divided) {
+            n += northwest->count(range, in) + northeast->count(range, in) + southwest->count(range, in) + southeast->count(range, in);
+        }
+        return n;
+    }
+    bool any(const Rectangle& range, Instrumentation& in) const {
+        if (total == 0 || !boundary.intersects(range)) {
+            return false;
+        }
+        in.on_node();
+        if (range.covers(boundary)) {
+            return true;
+        }
+        if (!divided) {
+            in.on_leaf();
+        }
+        for (auto& p : points) {
+            in.on_point_tested();
+            if (range.contains(p)) {
+                return true;
+            }
+        }
+        return divided && (northwest->any(range, in) || northeast->any(range, in) || southwest->any(range, in) || southeast->any(range, in));
+    }
+    std::vector<Point> intersect(const Rectangle& rect, Instrumentation& in) const {
+        std::vector<Point> result;
+        if (!boundary.intersects(rect)) {
+            return result;
+        }
+        scan(rect, result, in);
+        if (divided) {
+            auto res_nw = northwest->intersect(rect, in);
+            result.insert(result.end(), res_nw.begin(), res_nw.end());
+            auto res_ne = northeast->intersect(rect, in);
+            result.insert(result.end(), res_ne.begin(), res_ne.end());
+            auto res_sw = southwest->intersect(rect, in);
+            result.insert(result.end(), res_sw.begin(), res_sw.end());
+            auto res_se = southeast->intersect(rect, in);
+            result.insert(result.end(), res_se.begin(), res_se.end());
+        }
+        return result;
+    }
+    // True if some sample in this subtree blocks the sight line. Subtrees whose
+    // highest sample stays under the line are skipped, and quadrants are
+    // walked nearest-the-observer first so a blocked line exits early.
+    bool obstructed(const SightLine& line, Instrumentation& in) const {
+        if (line.clears(boundary.x - boundary.width, boundary.y - boundary.height, boundary.x + boundary.width, boundary.y + boundary.height, max_z)) {
+            return false;
+        }
+        in.on_node();
+        for (auto& p : points) {
+            in.on_point_tested();
+            if (line.blocks(p.x, p.y, p.elevation)) {
+                return true;
+            }
+        }
+        if (!divided) {
+            return false;
+        }
+        const Quadtree* order[4] = { northwest, northeast, southwest, southeast };
+        double key[4];
+        for (int i = 0; i < 4; i++) {
+            key[i] = (order[i]->boundary.x - line.x0) * line.dx + (order[i]->boundary.y - line.y0) * line.dy;
+        }
+        for (int i = 1; i < 4; i++) {
+            for (int k = i; k > 0 && key[k] < key[k - 1]; k--) {
+                std::swap(key[k], key[k - 1]);
+                std::swap(order[k], order[k - 1]);
+            }
+        }
+        for (int i = 0; i < 4; i++) {
+            if (order[i]->obstructed(line, in)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    bool is_smooth(const Rectangle& rect, int j, Instrumentation& in) const {
+        in.on_node();
+        coord_type w = rect.width / std::pow(2, j);
+        coord_type h = rect.height / std::pow(2, j);
+        if (divided) {
+            auto nw_smooth = northwest->is_smooth(rect, j, in);
+            auto ne_smooth = northeast->is_smooth(rect, j, in);
+            auto sw_smooth = southwest->is_smooth(rect, j, in);
+            auto se_smooth = southeast->is_smooth(rect, j, in);
+            return (nw_smooth && ne_smooth && sw_smooth && se_smooth);
+        }
+        in.on_leaf();
+        for (auto& p : points) {
+            in.on_point_tested();
+            Rectangle p_rect(p.x, p.y, w, h);
+            if (!p_rect.intersects(rect)) {
+                return false;
+            }
+        }
+        return true;
+    }
+public:
+    // tolerance is the RMS elevation error a leaf may carry before an
+    // error-driven split rule subdivides it; count-based rules ignore it.
+    Quadtree(Rectangle boundary_, double tolerance_ = 0) : boundary(boundary_), points(), fit(), northwest(nullptr), northeast(nullptr), southwest(nullptr), southeast(nullptr), max_z(-std::numeric_limits<double>::infinity()), total(0), tolerance(tolerance_), depth(0), divided(false), hooks(make_hooks()) {}
+    Quadtree(const Quadtree&) = delete;
+    Quadtree& operator=(const Quadtree&) = delete;
+    ~Quadtree() {
+        delete northwest;
+        delete northeast;
+        delete southwest;
+        delete southeast;
+    }
+    const Rectangle& bounds() const { return boundary; }
+    // Read-only structure for whole-tree walks (export, joins, layout): the
+    // points held by this node itself and its quadrants in NW, NE, SW, SE
+    // order, which are null unless is_divided().
+    const LeafBuffer<Point, Policy::capacity>& node_points() const { return points; }
+    bool is_divided() const { return divided; }
+    const Quadtree* child(int quadrant) const {
+        const Quadtree* children[4] = { northwest, northeast, southwest, southeast };
+        return children[quadrant];
+    }
+    // Number of points stored anywhere in this subtree.
+    std::size_t size() const { return total; }
+    // Highest elevation stored anywhere in this subtree; -infinity if empty.
+    double max_elevation() const { return max_z; }
+    // Counters and trace hookup for instrumented policies, e.g.
+    // qt.instrumentation().trace = &recorder.
+    Instrumentation& instrumentation() { return instr(); }
+    const Instrumentation& instrumentation() const { return instr(); }
+    // Stores p in exactly one node; returns false if p lies outside the tree.
+    bool insert(Point p) {
+        return insert(p, tolerance, instr());
+    }
+    // Splits a leaf into four empty quadrants; a no-op once divided.
+    void subdivide() {
+        if (!divided) {
+            subdivide(instr());
+        }
+    }
+    void compress() {
+        auto ignore = [](const Rectangle&) {};
+        compress(ignore);
+    }
+    // As compress(), also calling merged_into(bounds) for every node whose
+    // quadrants were folded back into it, e.g. to invalidate caches.
+    template <typename OnMerge>
+    void compress(OnMerge merged_into) {
+        TraceScope<Instrumentation> span(instr(), "compress", boundary.x, boundary.y, boundary.width, boundary.height);
+        compress(tolerance, instr(), merged_into);
+    }
+    // Node counts by depth, leaf fill and a structure/payload/slack byte split.
+    MemoryReport memory_report() const {
+        MemoryReport report;
+        report.node_size = sizeof(Quadtree);
+        report.leaf_capacity = Policy::capacity;
+        report.leaf_fill.resize(Policy::capacity + 2);
+        account(report);
+        return report;
+    }
+    // Compacts the tree without changing what any query returns: spilled
+    // points are trimmed to size (back inline where they fit) and subtrees
+    // holding no points are deleted. Returns the bytes released.
+    std::size_t shrink_to_fit() {
+        TraceScope<Instrumentation> span(instr(), "shrink_to_fit", boundary.x, boundary.y, boundary.width, boundary.height);
+        return shrink_to_fit_nodes();
+    }
+    void query(Rectangle range, std::vector<Point>& found) const {
+        TraceScope<Instrumentation> span(instr(), "query", range.x, range.y, range.width, range.height);
+        query(range, found, instr());
+    }
+    // Points inside a polygon, or within a corridor's radius of its path.
+    void query(const Polygon& region, std::vector<Point>& found) const {
+        TraceScope<Instrumentation> span(instr(), "query_polygon", (region.minx + region.maxx) / 2, (region.miny + region.maxy) / 2, (region.maxx - region.minx) / 2, (region.maxy - region.miny) / 2);
+        query_region(region, found, instr());
+    }
+    void query(const Corridor& region, std::vector<Point>& found) const {
+        TraceScope<Instrumentation> span(instr(), "query_corridor", (region.minx + region.maxx) / 2, (region.miny + region.maxy) / 2, (region.maxx - region.minx) / 2, (region.maxy - region.miny) / 2);
+        query_region(region, found, instr());
+    }
+    // How many points query(range) would return, without copying them.
+    std::size_t count(Rectangle range) const {
+        TraceScope<Instrumentation> span(instr(), "count", range.x, range.y, range.width, range.height);
+        return count(range, instr());
+    }
+    // Whether query(range) would return anything; stops at the first hit.
+    bool any(Rectangle range) const {
+        TraceScope<Instrumentation> span(instr(), "any", range.x, range.y, range.width, range.height);
+        return any(range, instr());
+    }
+    std::vector<Point> intersect(Rectangle rect) const {
+        TraceScope<Instrumentation> span(instr(), "intersect", rect.x, rect.y, rect.width, rect.height);
+        return intersect(rect, instr());
+    }
+    // Whether the eye at `from` (raised by observer_height) sees the point at
+    // `to` (raised by target_height): no sample within `radius` of the ground
+    // track between them may rise above the straight line joining the two.
+    bool line_of_sight(const Point& from, const Point& to, double observer_height = 0, double target_height = 0, double radius = 0) const {
+        SightLine line(from.x, from.y, from.elevation + observer_height, to.x, to.y, to.elevation + target_height, radius);
+        if (line.degenerate()) {
+            return true;
+        }
+        TraceScope<Instrumentation> span(instr(), "line_of_sight", (from.x + to.x) / 2, (from.y + to.y) / 2, std::abs(to.x - from.x) / 2, std::abs(to.y - from.y) / 2);
+        return !obstructed(line, instr());
+    }
+    bool is_smooth(Rectangle rect, int j) const {
+        TraceScope<Instrumentation> span(instr(), "is_smooth", rect.x, rect.y, rect.width, rect.height);
+        return is_smooth(rect, j, instr());
+    }
+};
+
+}  // namespace terrain
+
+#endif
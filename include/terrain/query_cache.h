@@ -0,0 +1,316 @@
+#ifndef TERRAIN_QUERY_CACHE_H
+#define TERRAIN_QUERY_CACHE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace terrain {
+
+struct QueryCacheOptions {
+    double quantum = 1.0;                   // rectangles snap outwards to this grid
+    std::size_t max_bytes = 64u << 20;      // entries plus cached points
+};
+
+struct QueryCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;       // dropped to stay under max_bytes
+    std::uint64_t invalidations = 0;   // dropped because the tree changed under them
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+
+    double hit_rate() const { return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0; }
+};
+
+// LRU cache of query() results in front of a Quadtree. Each range is grown
+// to whole quantum cells and the snapped window is what gets cached, so
+// viewports that differ by less than a cell share an entry; results are then
+// filtered back to the exact range. Mutate the tree through this class (or
+// call clear() afterwards):
+//   insert    drops entries whose window contains the new point
+//   compress  drops entries overlapping a node that absorbed its quadrants
+// Windows are also filed in a grid of buckets, so a mutation only tests the
+// entries filed near it rather than every cached window.
+// Like the tree itself, not safe for concurrent use.
+template <typename Tree>
+class QueryCache {
+public:
+    typedef typename Tree::Point Point;
+    typedef typename Tree::Rectangle Rectangle;
+
+    // Throws std::invalid_argument unless quantum is positive and finite.
+    QueryCache(Tree& tree_, const QueryCacheOptions& options_ = QueryCacheOptions()) : tree(tree_), options(checked(options_)) {}
+
+    void query(const Rectangle& range, std::vector<Point>& found) {
+        Key key = snap(range);
+        auto it = index.find(key);
+        if (it != index.end() && !it->second->window.covers(range)) {
+            // A range rounding put in this cell yet just outside the cached
+            // window; rebuild the entry wide enough for both.
+            erase(it->second);
+            it = index.end();
+        }
+        if (it != index.end()) {
+            counters.hits++;
+            lru.splice(lru.begin(), lru, it->second);
+        } else {
+            counters.misses++;
+            Entry entry{key, window(key, range), std::vector<Point>(), 0, Key(), 0};
+            tree.query(entry.window, entry.points);
+            entry.points.shrink_to_fit();
+            entry.bytes = entry_bytes(entry);
+            if (entry.bytes > options.max_bytes) {
+                filter(entry.points, range, found);
+                return;
+            }
+            lru.push_front(std::move(entry));
+            it = index.emplace(key, lru.begin()).first;
+            file(lru.begin());
+            counters.bytes += lru.front().bytes;
+            evict();
+        }
+        filter(it->second->points, range, found);
+    }
+    bool insert(Point p) {
+        if (!tree.insert(p)) {
+            return false;
+        }
+        drop_near(p.x, p.y, p.x, p.y, [&](const Entry& e) { return e.window.contains(p); });
+        return true;
+    }
+    void compress() {
+        tree.compress([&](const Rectangle& node) {
+            drop_near(node.x - node.width, node.y - node.height, node.x + node.width, node.y + node.height,
+                      [&](const Entry& e) { return e.window.intersects(node); });
+        });
+    }
+    void clear() {
+        lru.clear();
+        index.clear();
+        buckets.clear();
+        std::fill(std::begin(filed), std::end(filed), 0);
+        counters.bytes = 0;
+    }
+    QueryCacheStats stats() const {
+        QueryCacheStats s = counters;
+        s.entries = lru.size();
+        return s;
+    }
+    void reset_stats() {
+        counters.hits = counters.misses = counters.evictions = counters.invalidations = 0;
+    }
+private:
+    struct Key {
+        std::int64_t x0, y0, x1, y1;
+        bool operator==(const Key& o) const { return x0 == o.x0 && y0 == o.y0 && x1 == o.x1 && y1 == o.y1; }
+    };
+    struct KeyHash {
+        std::size_t operator()(const Key& k) const {
+            std::uint64_t h = 1469598103934665603ull;
+            for (std::int64_t v : { k.x0, k.y0, k.x1, k.y1 }) {
+                h = (h ^ static_cast<std::uint64_t>(v)) * 1099511628211ull;
+            }
+            return static_cast<std::size_t>(h);
+        }
+    };
+    struct Entry {
+        Key key;
+        Rectangle window;
+        std::vector<Point> points;
+        std::size_t bytes;
+        Key cells;  // the buckets it is filed in, at level
+        int level;
+    };
+    typedef std::list<Entry> List;
+    // Bucket (x, y) at level L covers quantum cells [x * 2^L, (x + 1) * 2^L)
+    // on each axis. An entry is filed at the lowest level whose buckets are
+    // at least as wide as its window, so it sits in at most 2x2 of them.
+    struct Bucket {
+        int level;
+        std::int64_t x, y;
+        bool operator==(const Bucket& o) const { return level == o.level && x == o.x && y == o.y; }
+    };
+    struct BucketHash {
+        std::size_t operator()(const Bucket& b) const {
+            return KeyHash()(Key{b.level, b.x, b.y, 0});
+        }
+    };
+    static const int kLevels = 64;
+
+    Tree& tree;
+    QueryCacheOptions options;
+    List lru;  // most recently used first
+    std::unordered_map<Key, typename List::iterator, KeyHash> index;
+    std::unordered_map<Bucket, std::vector<typename List::iterator>, BucketHash> buckets;
+    std::size_t filed[kLevels] = {};  // entries per level
+    QueryCacheStats counters;
+
+    static const QueryCacheOptions& checked(const QueryCacheOptions& o) {
+        if (!(o.quantum > 0) || !std::isfinite(o.quantum)) {
+            throw std::invalid_argument("quantum must be positive and finite");
+        }
+        return o;
+    }
+    // The quantum cell holding v, clamped well inside int64 so that bucket
+    // arithmetic cannot overflow for any coordinate.
+    std::int64_t cell(double v) const {
+        const double limit = 2305843009213693952.0;  // 2^61
+        double c = std::floor(v / options.quantum);
+        return static_cast<std::int64_t>(std::max(-limit, std::min(limit, c)));
+    }
+
+    Key snap(const Rectangle& r) const {
+        double q = options.quantum;
+        return Key{static_cast<std::int64_t>(std::floor((r.x - r.width) / q)), static_cast<std::int64_t>(std::floor((r.y - r.height) / q)),
+                   static_cast<std::int64_t>(std::ceil((r.x + r.width) / q)), static_cast<std::int64_t>(std::ceil((r.y + r.height) / q))};
+    }
+    // The cell-aligned box for k, built from its edges. Centre/half-extent
+    // form cannot hold every edge exactly, so the edges are then pushed out
+    // an ulp at a time until the box covers `range`, which is what makes
+    // filtering the cached points exact.
+    Rectangle window(const Key& k, const Rectangle& range) const {
+        typedef decltype(range.width) C;
+        double q = options.quantum;
+        C x0 = static_cast<C>(k.x0 * q), x1 = static_cast<C>(k.x1 * q), y0 = static_cast<C>(k.y0 * q), y1 = static_cast<C>(k.y1 * q);
+        for (;;) {
+            Rectangle w((x0 + x1) / 2, (y0 + y1) / 2, (x1 - x0) / 2, (y1 - y0) / 2);
+            bool short_x = w.x - w.width > range.x - range.width || w.x + w.width < range.x + range.width;
+            bool short_y = w.y - w.height > range.y - range.height || w.y + w.height < range.y + range.height;
+            if (!short_x && !short_y) {
+                return w;
+            }
+            if (short_x) {
+                x0 = step(x0, -1);
+                x1 = step(x1, 1);
+            }
+            if (short_y) {
+                y0 = step(y0, -1);
+                y1 = step(y1, 1);
+            }
+        }
+    }
+    template <typename C>
+    static C step(C v, int direction) {
+        if constexpr (std::is_floating_point<C>::value) {
+            return std::nextafter(v, direction * std::numeric_limits<C>::infinity());
+        } else {
+            return v + direction;
+        }
+    }
+    // The list node, its index and bucket slots (roughly) and the points it
+    // holds.
+    static std::size_t entry_bytes(const Entry& e) {
+        return sizeof(Entry) + 8 * sizeof(void*) + e.points.capacity() * sizeof(Point);
+    }
+    static void filter(const std::vector<Point>& cached, const Rectangle& range, std::vector<Point>& found) {
+        for (auto& p : cached) {
+            if (range.contains(p)) {
+                found.push_back(p);
+            }
+        }
+    }
+    // Cells are taken from the window's own edges, and cell() is monotonic,
+    // so any point or box the window touches lands in one of its buckets.
+    void file(typename List::iterator it) {
+        const Rectangle& w = it->window;
+        Key c{cell(w.x - w.width), cell(w.y - w.height), cell(w.x + w.width), cell(w.y + w.height)};
+        std::uint64_t span = static_cast<std::uint64_t>(std::max(c.x1 - c.x0, c.y1 - c.y0)) + 1;
+        int level = 0;
+        while ((std::uint64_t(1) << level) < span) {
+            level++;
+        }
+        it->level = level;
+        it->cells = Key{c.x0 >> level, c.y0 >> level, c.x1 >> level, c.y1 >> level};
+        for (std::int64_t x = it->cells.x0; x <= it->cells.x1; x++) {
+            for (std::int64_t y = it->cells.y0; y <= it->cells.y1; y++) {
+                buckets[Bucket{level, x, y}].push_back(it);
+            }
+        }
+        filed[level]++;
+    }
+    void unfile(typename List::iterator it) {
+        for (std::int64_t x = it->cells.x0; x <= it->cells.x1; x++) {
+            for (std::int64_t y = it->cells.y0; y <= it->cells.y1; y++) {
+                auto b = buckets.find(Bucket{it->level, x, y});
+                auto& slot = b->second;
+                slot.erase(std::find(slot.begin(), slot.end(), it));
+                if (slot.empty()) {
+                    buckets.erase(b);
+                }
+            }
+        }
+        filed[it->level]--;
+    }
+    void erase(typename List::iterator it) {
+        counters.bytes -= it->bytes;
+        index.erase(it->key);
+        unfile(it);
+        lru.erase(it);
+    }
+    void evict() {
+        while (counters.bytes > options.max_bytes && !lru.empty()) {
+            erase(std::prev(lru.end()));
+            counters.evictions++;
+        }
+    }
+    // Drops the entries stale() picks out among those filed near the box
+    // [x0, x1] x [y0, y1]; falls back to a scan of every entry when the box
+    // covers more buckets than there are entries.
+    template <typename Pred>
+    void drop_near(double x0, double y0, double x1, double y1, Pred stale) {
+        std::int64_t cx0 = cell(x0), cy0 = cell(y0), cx1 = cell(x1), cy1 = cell(y1);
+        std::uint64_t visits = 0;
+        for (int level = 0; level < kLevels && visits <= lru.size(); level++) {
+            if (filed[level] != 0) {
+                std::uint64_t w = static_cast<std::uint64_t>((cx1 >> level) - (cx0 >> level)) + 1;
+                std::uint64_t h = static_cast<std::uint64_t>((cy1 >> level) - (cy0 >> level)) + 1;
+                visits += w > lru.size() || h > lru.size() ? lru.size() + 1 : w * h;
+            }
+        }
+        std::vector<typename List::iterator> near;
+        if (visits > lru.size()) {
+            for (auto it = lru.begin(); it != lru.end(); ++it) {
+                near.push_back(it);
+            }
+        } else {
+            for (int level = 0; level < kLevels; level++) {
+                if (filed[level] == 0) {
+                    continue;
+                }
+                for (std::int64_t x = cx0 >> level; x <= cx1 >> level; x++) {
+                    for (std::int64_t y = cy0 >> level; y <= cy1 >> level; y++) {
+                        auto b = buckets.find(Bucket{level, x, y});
+                        if (b != buckets.end()) {
+                            near.insert(near.end(), b->second.begin(), b->second.end());
+                        }
+                    }
+                }
+            }
+            // An entry filed in several buckets is found once per bucket.
+            auto by_node = [](typename List::iterator a, typename List::iterator b) { return std::less<const Entry*>()(&*a, &*b); };
+            std::sort(near.begin(), near.end(), by_node);
+            near.erase(std::unique(near.begin(), near.end()), near.end());
+        }
+        for (auto it : near) {
+            if (stale(*it)) {
+                erase(it);
+                counters.invalidations++;
+            }
+        }
+    }
+};
+
+}  // namespace terrain
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef TERRAIN_REGION_H
+#define TERRAIN_REGION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace terrain {
+
+// How an axis-aligned box relates to a query region.
+enum class Coverage {
+    kOutside,
+    kInside,
+    kCrossing
+};
+
+namespace detail {
+
+// Whether segment a-b touches the closed box [minx, maxx] x [miny, maxy].
+inline bool segment_hits_box(double ax, double ay, double bx, double by, double minx, double miny, double maxx, double maxy) {
+    double t0 = 0, t1 = 1;
+    double d[2] = { bx - ax, by - ay };
+    double o[2] = { ax, ay };
+    double lo[2] = { minx, miny };
+    double hi[2] = { maxx, maxy };
+    for (int k = 0; k < 2; k++) {
+        if (d[k] == 0) {
+            if (o[k] < lo[k] || o[k] > hi[k]) {
+                return false;
+            }
+            continue;
+        }
+        double a = (lo[k] - o[k]) / d[k];
+        double b = (hi[k] - o[k]) / d[k];
+        if (a > b) {
+            std::swap(a, b);
+        }
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, b);
+        if (t0 > t1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline double segment_distance2(double px, double py, double ax, double ay, double bx, double by) {
+    double dx = bx - ax, dy = by - ay;
+    double len2 = dx * dx + dy * dy;
+    double t = len2 > 0 ? ((px - ax) * dx + (py - ay) * dy) / len2 : 0;
+    t = std::min(1.0, std::max(0.0, t));
+    double ex = ax + t * dx - px, ey = ay + t * dy - py;
+    return ex * ex + ey * ey;
+}
+
+inline double box_distance2(double px, double py, double minx, double miny, double maxx, double maxy) {
+    double dx = std::max(0.0, std::max(minx - px, px - maxx));
+    double dy = std::max(0.0, std::max(miny - py, py - maxy));
+    return dx * dx + dy * dy;
+}
+
+}  // namespace detail
+
+// Simple polygon given by its vertices in order (either winding; the closing
+// edge is implied). Membership uses the even-odd rule, edges included.
+class Polygon {
+public:
+    struct Vertex {
+        double x, y;
+    };
+    explicit Polygon(std::vector<Vertex> vertices_) : vertices(std::move(vertices_)) {
+        minx = miny = std::numeric_limits<double>::infinity();
+        maxx = maxy = -std::numeric_limits<double>::infinity();
+        for (auto& v : vertices) {
+            minx = std::min(minx, v.x);
+            miny = std::min(miny, v.y);
+            maxx = std::max(maxx, v.x);
+            maxy = std::max(maxy, v.y);
+        }
+    }
+    double minx, miny, maxx, maxy;
+    const std::vector<Vertex>& points() const { return vertices; }
+    bool contains(double x, double y) const {
+        if (x < minx || x > maxx || y < miny || y > maxy) {
+            return false;
+        }
+        bool inside = false;
+        for (std::size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++) {
+            const Vertex& a = vertices[i];
+            const Vertex& b = vertices[j];
+            if (on_segment(x, y, a, b)) {
+                return true;
+            }
+            if ((a.y > y) != (b.y > y) && x < (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x) {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+    // A box no edge touches is wholly inside or wholly outside, and its
+    // centre says which.
+    Coverage classify(double bminx, double bminy, double bmaxx, double bmaxy) const {
+        if (bmaxx < minx || bminx > maxx || bmaxy < miny || bminy > maxy) {
+            return Coverage::kOutside;
+        }
+        for (std::size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++) {
+            if (detail::segment_hits_box(vertices[j].x, vertices[j].y, vertices[i].x, vertices[i].y, bminx, bminy, bmaxx, bmaxy)) {
+                return Coverage::kCrossing;
+            }
+        }
+        return contains((bminx + bmaxx) / 2, (bminy + bmaxy) / 2) ? Coverage::kInside : Coverage::kOutside;
+    }
+private:
+    std::vector<Vertex> vertices;
+    static bool on_segment(double x, double y, const Vertex& a, const Vertex& b) {
+        double cross = (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+        return cross == 0 && x >= std::min(a.x, b.x) && x <= std::max(a.x, b.x) && y >= std::min(a.y, b.y) && y <= std::max(a.y, b.y);
+    }
+};
+
+// Everything within `radius` of a polyline, e.g. a pipeline right of way.
+class Corridor {
+public:
+    typedef Polygon::Vertex Vertex;
+    Corridor(std::vector<Vertex> path_, double radius_) : radius(radius_), path(std::move(path_)) {
+        minx = miny = std::numeric_limits<double>::infinity();
+        maxx = maxy = -std::numeric_limits<double>::infinity();
+        for (auto& v : path) {
+            minx = std::min(minx, v.x - radius);
+            miny = std::min(miny, v.y - radius);
+            maxx = std::max(maxx, v.x + radius);
+            maxy = std::max(maxy, v.y + radius);
+        }
+    }
+    double radius;
+    double minx, miny, maxx, maxy;
+    const std::vector<Vertex>& points() const { return path; }
+    bool contains(double x, double y) const {
+        if (x < minx || x > maxx || y < miny || y > maxy) {
+            return false;
+        }
+        double r2 = radius * radius;
+        for (std::size_t i = 0; i < segments(); i++) {
+            if (detail::segment_distance2(x, y, vertex(i).x, vertex(i).y, vertex(i + 1).x, vertex(i + 1).y) <= r2) {
+                return true;
+            }
+        }
+        return false;
+    }
+    // Each segment's buffer is convex, so a box is inside when one buffer
+    // holds all four corners, and outside when every buffer misses it.
+    Coverage classify(double bminx, double bminy, double bmaxx, double bmaxy) const {
+        if (bmaxx < minx || bminx > maxx || bmaxy < miny || bminy > maxy) {
+            return Coverage::kOutside;
+        }
+        double r2 = radius * radius;
+        bool near = false;
+        for (std::size_t i = 0; i < segments(); i++) {
+            const Vertex& a = vertex(i);
+            const Vertex& b = vertex(i + 1);
+            if (detail::segment_distance2(bminx, bminy, a.x, a.y, b.x, b.y) <= r2 && detail::segment_distance2(bmaxx, bminy, a.x, a.y, b.x, b.y) <= r2 &&
+                detail::segment_distance2(bminx, bmaxy, a.x, a.y, b.x, b.y) <= r2 && detail::segment_distance2(bmaxx, bmaxy, a.x, a.y, b.x, b.y) <= r2) {
+                return Coverage::kInside;
+            }
+            if (!near) {
+                near = detail::segment_hits_box(a.x, a.y, b.x, b.y, bminx, bminy, bmaxx, bmaxy) ||
+                       segment_box_distance2(a, b, bminx, bminy, bmaxx, bmaxy) <= r2;
+            }
+        }
+        return near ? Coverage::kCrossing : Coverage::kOutside;
+    }
+private:
+    std::vector<Vertex> path;
+    // A lone vertex is a segment of length zero.
+    std::size_t segments() const { return path.size() > 1 ? path.size() - 1 : (path.empty() ? 0 : 1); }
+    const Vertex& vertex(std::size_t i) const { return path[std::min(i, path.size() - 1)]; }
+    // Distance between a segment and a box it does not cross: the closest
+    // pair always involves an endpoint or a box corner.
+    static double segment_box_distance2(const Vertex& a, const Vertex& b, double bminx, double bminy, double bmaxx, double bmaxy) {
+        double d = std::min(detail::box_distance2(a.x, a.y, bminx, bminy, bmaxx, bmaxy), detail::box_distance2(b.x, b.y, bminx, bminy, bmaxx, bmaxy));
+        d = std::min(d, detail::segment_distance2(bminx, bminy, a.x, a.y, b.x, b.y));
+        d = std::min(d, detail::segment_distance2(bmaxx, bminy, a.x, a.y, b.x, b.y));
+        d = std::min(d, detail::segment_distance2(bminx, bmaxy, a.x, a.y, b.x, b.y));
+        d = std::min(d, detail::segment_distance2(bmaxx, bmaxy, a.x, a.y, b.x, b.y));
+        return d;
+    }
+};
+
+}  // namespace terrain
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef TERRAIN_RLE_H
+#define TERRAIN_RLE_H
+
+#include <cstddef>
+#include <vector>
+
+namespace terrain {
+
+// Replaces values with (value, run length) pairs.
+inline void compressRLE(std::vector<int>& values) {
+    if (values.empty()) {
+        return;
+    }
+    std::vector<int> compressed;
+    int count = 1;
+    int currentValue = values[0];
+
+    for (std::size_t i = 1; i < values.size(); i++) {
+        if (values[i] == currentValue) {
+            count++;
+        } else {
+            compressed.push_back(currentValue);
+            compressed.push_back(count);
+            count = 1;
+            currentValue = values[i];
+        }
+    }
+
+    compressed.push_back(currentValue);
+    compressed.push_back(count);
+
+    values = compressed;
+}
+
+}  // namespace terrain
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef TERRAIN_SIGHT_LINE_H
+#define TERRAIN_SIGHT_LINE_H
+
+#include <algorithm>
+#include <cmath>
+
+namespace terrain {
+
+// Straight line of sight between two eye points (x0, y0, z0) and (x1, y1, z1).
+// A terrain sample blocks it when it lies within `radius` of the ground track,
+// strictly between the two ends, and rises above the line at that spot.
+class SightLine {
+public:
+    double x0, y0, z0;
+    double dx, dy, dz;
+    double radius;
+    SightLine(double x0_, double y0_, double z0_, double x1, double y1, double z1, double radius_)
+        : x0(x0_), y0(y0_), z0(z0_), dx(x1 - x0_), dy(y1 - y0_), dz(z1 - z0_), radius(radius_), len2(dx * dx + dy * dy) {}
+    bool degenerate() const { return len2 == 0; }
+    // Height of the line at parameter t in [0, 1].
+    double height_at(double t) const { return z0 + t * dz; }
+    bool blocks(double x, double y, double z) const {
+        double t = ((x - x0) * dx + (y - y0) * dy) / len2;
+        if (t <= 0 || t >= 1) {
+            return false;
+        }
+        double cross = (x - x0) * dy - (y - y0) * dx;
+        if (cross * cross > radius * radius * len2) {
+            return false;
+        }
+        return z > height_at(t);
+    }
+    // Clips the ground track to the box [minx, maxx] x [miny, maxy] grown by
+    // radius; on success [t0, t1] is the part of the line over the box.
+    bool clip(double minx, double miny, double maxx, double maxy, double& t0, double& t1) const {
+        t0 = 0;
+        t1 = 1;
+        return clip_axis(x0, dx, minx - radius, maxx + radius, t0, t1) && clip_axis(y0, dy, miny - radius, maxy + radius, t0, t1);
+    }
+    // True when nothing in a box whose highest sample is max_z can block the
+    // line: max_z sits below the line everywhere the box is crossed.
+    bool clears(double minx, double miny, double maxx, double maxy, double max_z) const {
+        double t0, t1;
+        if (!clip(minx, miny, maxx, maxy, t0, t1)) {
+            return true;
+        }
+        return max_z <= std::min(height_at(t0), height_at(t1));
+    }
+private:
+    double len2;
+    static bool clip_axis(double origin, double delta, double lo, double hi, double& t0, double& t1) {
+        if (delta == 0) {
+            return origin >= lo && origin <= hi;
+        }
+        double a = (lo - origin) / delta;
+        double b = (hi - origin) / delta;
+        if (a > b) {
+            std::swap(a, b);
+        }
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, b);
+        return t0 <= t1;
+    }
+};
+
+}  // namespace terrain
+
+#endif
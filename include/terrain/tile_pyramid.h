@@ -0,0 +1,425 @@
+#ifndef TERRAIN_TILE_PYRAMID_H
+#define TERRAIN_TILE_PYRAMID_H
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "terrain/morton.h"
+#include "terrain/rle.h"
+
+namespace terrain {
+
+// Tiles follow the XYZ scheme over the tree's root square: zoom z has 2^z by
+// 2^z tiles, x grows east and y grows south (towards +y, like the quadtree's
+// NW/NE/SW/SE order), so tile (z, x, y) covers exactly one depth-z quadrant.
+// A tile is a tile_size^2 heightmap of mean elevations quantized to
+// vertical_resolution, with kTileNoData where no sample falls.
+enum class TileEncoding {
+    kRaw,  // row-major little-endian int32
+    kRLE   // pixels in quadtree (Z) order, run-length encoded, zigzag varints
+};
+
+const std::int32_t kTileNoData = std::numeric_limits<std::int32_t>::min();
+
+struct TilePyramidOptions {
+    int max_zoom = 6;
+    int tile_size = 256;
+    double vertical_resolution = 0.1;
+    TileEncoding encoding = TileEncoding::kRLE;
+    unsigned threads = 0;              // encoder threads; 0 = hardware concurrency
+    std::size_t queue_capacity = 64;   // finished tiles waiting for an encoder
+};
+
+struct TilePyramidStats {
+    std::vector<std::size_t> tiles;    // per zoom level
+    std::vector<std::size_t> bytes;    // encoded bytes per zoom level
+    std::size_t failed_writes = 0;
+};
+
+namespace detail {
+
+inline std::uint32_t zigzag(std::int32_t v) {
+    return (static_cast<std::uint32_t>(v) << 1) ^ static_cast<std::uint32_t>(v >> 31);
+}
+
+inline std::int32_t unzigzag(std::uint32_t v) {
+    return static_cast<std::int32_t>(v >> 1) ^ -static_cast<std::int32_t>(v & 1);
+}
+
+inline void put_varint(std::string& out, std::uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline bool get_varint(const std::string& in, std::size_t& pos, std::uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35 && pos < in.size(); shift += 7) {
+        std::uint8_t byte = static_cast<std::uint8_t>(in[pos++]);
+        v |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Row-major pixel index of the k-th pixel in depth-first NW, NE, SW, SE
+// order, the same order quadtree_compression_RLE walks its leaves in.
+// tile_size is a power of two, so the Morton keys of its pixels are exactly
+// 0 .. tile_size^2 - 1.
+inline std::vector<std::uint32_t> zorder(int tile_size) {
+    std::vector<std::uint32_t> order(static_cast<std::size_t>(tile_size) * tile_size);
+    for (std::uint32_t y = 0; y < static_cast<std::uint32_t>(tile_size); y++) {
+        for (std::uint32_t x = 0; x < static_cast<std::uint32_t>(tile_size); x++) {
+            order[morton_key(x, y)] = y * tile_size + x;
+        }
+    }
+    return order;
+}
+
+struct FinishedTile {
+    int z, x, y;
+    std::vector<std::int32_t> heights;
+};
+
+// Bounded hand-off between the tree walk and the encoder threads; push()
+// blocks while full, which is what keeps export memory bounded.
+class TileQueue {
+public:
+    explicit TileQueue(std::size_t capacity_) : capacity(std::max<std::size_t>(capacity_, 1)), closed(false) {}
+    void push(FinishedTile tile) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [&] { return items.size() < capacity; });
+        items.push_back(std::move(tile));
+        not_empty.notify_one();
+    }
+    bool pop(FinishedTile& tile) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [&] { return !items.empty() || closed; });
+        if (items.empty()) {
+            return false;
+        }
+        tile = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+    }
+private:
+    std::size_t capacity;
+    bool closed;
+    std::deque<FinishedTile> items;
+    std::mutex mutex;
+    std::condition_variable not_full, not_empty;
+};
+
+// Per-pixel elevation sums and sample counts for one tile.
+struct TileAccumulator {
+    std::vector<double> sum;
+    std::vector<std::uint32_t> count;
+    bool any = false;
+    void reset(int tile_size) {
+        sum.assign(static_cast<std::size_t>(tile_size) * tile_size, 0.0);
+        count.assign(sum.size(), 0);
+        any = false;
+    }
+};
+
+// Single depth-first pass that builds max-zoom tiles from points and every
+// coarser tile by 2x2 downsampling of its four children, so only one
+// accumulator per zoom level is alive at a time.
+template <typename Tree>
+class TilePyramidBuilder {
+public:
+    typedef typename Tree::Point Point;
+    TilePyramidBuilder(const Tree& tree_, const TilePyramidOptions& options_, TileQueue& queue_)
+        : tree(tree_), options(options_), queue(queue_), T(options_.tile_size), levels(options_.max_zoom + 1) {
+        const auto& b = tree.bounds();
+        root_minx = b.x - b.width;
+        root_miny = b.y - b.height;
+        root_w = 2 * b.width;
+        root_h = 2 * b.height;
+    }
+    void run() {
+        std::vector<Point> carried;
+        build(0, 0, 0, &tree, carried);
+    }
+private:
+    const Tree& tree;
+    const TilePyramidOptions& options;
+    TileQueue& queue;
+    int T;
+    std::vector<TileAccumulator> levels;
+    double root_minx, root_miny, root_w, root_h;
+
+    static bool empty_subtree(const Tree* node) {
+        return node == nullptr || node->max_elevation() == -std::numeric_limits<double>::infinity();
+    }
+    void rasterize(const Point& p, TileAccumulator& acc, double minx, double miny, double px, double py) const {
+        int cx = std::min(T - 1, std::max(0, static_cast<int>((p.x - minx) / px)));
+        int cy = std::min(T - 1, std::max(0, static_cast<int>((p.y - miny) / py)));
+        std::size_t i = static_cast<std::size_t>(cy) * T + cx;
+        acc.sum[i] += p.elevation;
+        acc.count[i]++;
+        acc.any = true;
+    }
+    void rasterize_subtree(const Tree* node, TileAccumulator& acc, double minx, double miny, double px, double py) const {
+        for (auto& p : node->node_points()) {
+            rasterize(p, acc, minx, miny, px, py);
+        }
+        if (node->is_divided()) {
+            for (int q = 0; q < 4; q++) {
+                rasterize_subtree(node->child(q), acc, minx, miny, px, py);
+            }
+        }
+    }
+    void downsample(const TileAccumulator& child, int quadrant, TileAccumulator& parent) const {
+        int half = T / 2;
+        int ox = (quadrant & 1) * half;
+        int oy = (quadrant >> 1) * half;
+        for (int y = 0; y < T; y++) {
+            for (int x = 0; x < T; x++) {
+                std::size_t from = static_cast<std::size_t>(y) * T + x;
+                if (child.count[from] == 0) {
+                    continue;
+                }
+                std::size_t to = static_cast<std::size_t>(oy + y / 2) * T + (ox + x / 2);
+                parent.sum[to] += child.sum[from];
+                parent.count[to] += child.count[from];
+            }
+        }
+        parent.any = true;
+    }
+    // node is the tree node for this exact tile, or null once the tree is
+    // shallower than the pyramid; carried holds ancestors' points in the tile.
+    bool build(int z, int tx, int ty, const Tree* node, std::vector<Point>& carried) {
+        TileAccumulator& acc = levels[z];
+        acc.reset(T);
+        double tw = root_w / (1 << z), th = root_h / (1 << z);
+        double minx = root_minx + tx * tw, miny = root_miny + ty * th;
+        if (z == options.max_zoom) {
+            for (auto& p : carried) {
+                rasterize(p, acc, minx, miny, tw / T, th / T);
+            }
+            if (!empty_subtree(node)) {
+                rasterize_subtree(node, acc, minx, miny, tw / T, th / T);
+            }
+        } else {
+            double cx = minx + tw / 2, cy = miny + th / 2;
+            std::vector<Point> parts[4];
+            auto route = [&](const Point& p) {
+                parts[(p.x <= cx ? 0 : 1) + (p.y <= cy ? 0 : 2)].push_back(p);
+            };
+            for (auto& p : carried) {
+                route(p);
+            }
+            std::vector<Point>().swap(carried);
+            if (node != nullptr) {
+                for (auto& p : node->node_points()) {
+                    route(p);
+                }
+            }
+            for (int q = 0; q < 4; q++) {
+                const Tree* sub = (node != nullptr && node->is_divided()) ? node->child(q) : nullptr;
+                if (empty_subtree(sub) && parts[q].empty()) {
+                    continue;
+                }
+                if (build(z + 1, 2 * tx + (q & 1), 2 * ty + (q >> 1), sub, parts[q])) {
+                    downsample(levels[z + 1], q, acc);
+                }
+            }
+        }
+        if (!acc.any) {
+            return false;
+        }
+        emit(z, tx, ty, acc);
+        return true;
+    }
+    void emit(int z, int tx, int ty, const TileAccumulator& acc) {
+        FinishedTile tile{z, tx, ty, std::vector<std::int32_t>(acc.sum.size(), kTileNoData)};
+        for (std::size_t i = 0; i < acc.sum.size(); i++) {
+            if (acc.count[i] != 0) {
+                double v = std::round(acc.sum[i] / acc.count[i] / options.vertical_resolution);
+                v = std::min<double>(std::max<double>(v, kTileNoData + 1.0), std::numeric_limits<std::int32_t>::max());
+                tile.heights[i] = static_cast<std::int32_t>(v);
+            }
+        }
+        queue.push(std::move(tile));
+    }
+};
+
+}  // namespace detail
+
+// Encodes and decodes tiles of one size; holds the Z-order table so it is
+// built once per export rather than once per tile. Safe to share between
+// threads.
+class TileCodec {
+public:
+    TileCodec(int tile_size_, TileEncoding encoding_)
+        : tile_size(tile_size_), encoding(encoding_), order(encoding_ == TileEncoding::kRLE ? detail::zorder(tile_size_) : std::vector<std::uint32_t>()) {}
+    std::string encode(const std::vector<std::int32_t>& heights) const {
+        std::string out;
+        if (encoding == TileEncoding::kRaw) {
+            out.reserve(heights.size() * 4);
+            for (std::int32_t h : heights) {
+                std::uint32_t u = static_cast<std::uint32_t>(h);
+                for (int b = 0; b < 4; b++) {
+                    out.push_back(static_cast<char>((u >> (8 * b)) & 0xff));
+                }
+            }
+            return out;
+        }
+        std::vector<int> values(order.size());
+        for (std::size_t k = 0; k < order.size(); k++) {
+            values[k] = heights[order[k]];
+        }
+        compressRLE(values);
+        for (std::size_t i = 0; i + 1 < values.size(); i += 2) {
+            detail::put_varint(out, detail::zigzag(values[i]));
+            detail::put_varint(out, static_cast<std::uint32_t>(values[i + 1]));
+        }
+        return out;
+    }
+    // Throws std::runtime_error on malformed input.
+    std::vector<std::int32_t> decode(const std::string& bytes) const {
+        std::size_t n = static_cast<std::size_t>(tile_size) * tile_size;
+        std::vector<std::int32_t> heights(n, kTileNoData);
+        if (encoding == TileEncoding::kRaw) {
+            if (bytes.size() != n * 4) {
+                throw std::runtime_error("raw tile has the wrong size");
+            }
+            for (std::size_t i = 0; i < n; i++) {
+                std::uint32_t u = 0;
+                for (int b = 0; b < 4; b++) {
+                    u |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(bytes[4 * i + b])) << (8 * b);
+                }
+                heights[i] = static_cast<std::int32_t>(u);
+            }
+            return heights;
+        }
+        std::size_t pos = 0, k = 0;
+        while (pos < bytes.size()) {
+            std::uint32_t value, run;
+            if (!detail::get_varint(bytes, pos, value) || !detail::get_varint(bytes, pos, run) || k + run > n) {
+                throw std::runtime_error("corrupt RLE tile");
+            }
+            for (std::uint32_t r = 0; r < run; r++) {
+                heights[order[k++]] = detail::unzigzag(value);
+            }
+        }
+        if (k != n) {
+            throw std::runtime_error("truncated RLE tile");
+        }
+        return heights;
+    }
+private:
+    int tile_size;
+    TileEncoding encoding;
+    std::vector<std::uint32_t> order;
+};
+
+inline std::string encode_tile(const std::vector<std::int32_t>& heights, int tile_size, TileEncoding encoding) {
+    return TileCodec(tile_size, encoding).encode(heights);
+}
+
+inline std::vector<std::int32_t> decode_tile(const std::string& bytes, int tile_size, TileEncoding encoding) {
+    return TileCodec(tile_size, encoding).decode(bytes);
+}
+
+// Exports the whole pyramid for zooms 0..max_zoom in one walk of the tree.
+// sink(z, x, y, bytes) is called from the encoder threads, possibly
+// concurrently, once per non-empty tile (coarser tiles after their children);
+// a false return or an exception counts as a failed write. Throws std::invalid_argument for a
+// tile_size that is not a power of two or a negative max_zoom.
+template <typename Tree>
+TilePyramidStats export_tile_pyramid(const Tree& tree, const TilePyramidOptions& options,
+                                     const std::function<bool(int, int, int, const std::string&)>& sink) {
+    if (options.tile_size < 2 || (options.tile_size & (options.tile_size - 1)) != 0) {
+        throw std::invalid_argument("tile_size must be a power of two");
+    }
+    if (options.max_zoom < 0 || options.max_zoom > 30) {
+        throw std::invalid_argument("max_zoom must be in [0, 30]");
+    }
+    TilePyramidStats stats;
+    stats.tiles.assign(options.max_zoom + 1, 0);
+    stats.bytes.assign(options.max_zoom + 1, 0);
+    std::mutex stats_mutex;
+    detail::TileQueue queue(options.queue_capacity);
+    TileCodec codec(options.tile_size, options.encoding);
+    auto encoder = [&]() {
+        detail::FinishedTile tile;
+        while (queue.pop(tile)) {
+            std::string bytes = codec.encode(tile.heights);
+            bool ok = false;
+            try {
+                ok = sink(tile.z, tile.x, tile.y, bytes);
+            } catch (...) {
+                // Nothing on an encoder thread may throw past it.
+            }
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            stats.tiles[tile.z]++;
+            stats.bytes[tile.z] += bytes.size();
+            if (!ok) {
+                stats.failed_writes++;
+            }
+        }
+    };
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; i++) {
+        pool.emplace_back(encoder);
+    }
+    try {
+        detail::TilePyramidBuilder<Tree>(tree, options, queue).run();
+    } catch (...) {
+        queue.close();
+        for (auto& t : pool) {
+            t.join();
+        }
+        throw;
+    }
+    queue.close();
+    for (auto& t : pool) {
+        t.join();
+    }
+    return stats;
+}
+
+// export_tile_pyramid into directory/z/x/y.bin (raw) or y.rle files.
+template <typename Tree>
+TilePyramidStats write_tile_pyramid(const Tree& tree, const std::string& directory, const TilePyramidOptions& options) {
+    const char* ext = options.encoding == TileEncoding::kRaw ? ".bin" : ".rle";
+    return export_tile_pyramid(tree, options, [&](int z, int x, int y, const std::string& bytes) {
+        std::filesystem::path dir = std::filesystem::path(directory) / std::to_string(z) / std::to_string(x);
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        std::ofstream file(dir / (std::to_string(y) + ext), std::ios::binary);
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        return static_cast<bool>(file);
+    });
+}
+
+}  // namespace terrain
+
+#endif
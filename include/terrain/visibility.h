@@ -0,0 +1,78 @@
+#ifndef TERRAIN_VISIBILITY_H
+#define TERRAIN_VISIBILITY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "terrain/quadtree.h"
+
+namespace terrain {
+
+// Regular grid of target cells: nx by ny cells of size `cell`, the first one
+// centred on (x0, y0), rows running towards +y.
+struct ViewshedGrid {
+    double x0, y0, cell;
+    int nx, ny;
+};
+
+enum ViewshedCell : std::int8_t {
+    kNoData = -1,
+    kHidden = 0,
+    kVisible = 1
+};
+
+// Viewshed of `observer` over `grid`. Each cell's ground height is the mean of
+// the samples inside it (cells without samples are kNoData), and the cell is
+// kVisible when the tree's line_of_sight from the observer reaches it. Rows are
+// handed out to `threads` workers (0 = hardware concurrency); the tree is only
+// read, so it must not be instrumented or modified meanwhile.
+template <typename Tree>
+std::vector<std::int8_t> viewshed(const Tree& tree, const typename Tree::Point& observer, const ViewshedGrid& grid,
+                                  double observer_height, double target_height, double radius, unsigned threads = 0) {
+    static_assert(!Tree::Instrumentation::enabled, "instrumented trees cannot be queried from several threads");
+    typedef typename Tree::Point Point;
+    typedef typename Tree::Rectangle Rectangle;
+    std::vector<std::int8_t> out(static_cast<std::size_t>(grid.nx) * grid.ny, kNoData);
+    std::atomic<int> next_row(0);
+    auto worker = [&]() {
+        std::vector<Point> found;
+        for (int row = next_row++; row < grid.ny; row = next_row++) {
+            for (int col = 0; col < grid.nx; col++) {
+                double cx = grid.x0 + col * grid.cell;
+                double cy = grid.y0 + row * grid.cell;
+                found.clear();
+                tree.query(Rectangle(cx, cy, grid.cell / 2, grid.cell / 2), found);
+                if (found.empty()) {
+                    continue;
+                }
+                double ground = 0;
+                for (auto& p : found) {
+                    ground += p.elevation;
+                }
+                ground /= found.size();
+                bool seen = tree.line_of_sight(observer, Point(cx, cy, ground), observer_height, target_height, radius);
+                out[static_cast<std::size_t>(row) * grid.nx + col] = seen ? kVisible : kHidden;
+            }
+        }
+    };
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : pool) {
+        t.join();
+    }
+    return out;
+}
+
+}  // namespace terrain
+
+#endif
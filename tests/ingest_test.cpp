@@ -0,0 +1,53 @@
+// Streaming ingestion: every accepted point reaches the tree, and options
+// that would stall the commit thread are refused.
+#include <chrono>
+#include <stdexcept>
+
+#include "terrain/ingest.h"
+#include "terrain/quadtree.h"
+#include "test_support.h"
+
+namespace {
+
+// Everything pushed lands in the tree by flush(); options that would stall
+// the commit thread are refused up front.
+void test_ingest() {
+    typedef terrain::Quadtree<> Tree;
+    Tree tree(terrain::Rectangle(0, 0, 100, 100));
+    {
+        terrain::IngestOptions options;
+        options.queue_capacity = 256;
+        options.max_batch = 100;
+        terrain::StreamingIngestor<Tree> ingest(tree, options);
+        for (int i = 0; i < 5000; i++) {
+            ingest.push(terrain::Point(i % 200 - 99.5, i / 50 - 49.5, 0));
+        }
+        ingest.flush();
+        CHECK(ingest.read([](const Tree& t) { return t.size(); }) == 5000);
+    }
+    auto rejects = [&](terrain::IngestOptions options) {
+        try {
+            terrain::StreamingIngestor<Tree> ingest(tree, options);
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    terrain::IngestOptions options;
+    options.max_batch = 0;
+    CHECK(rejects(options));
+    options = terrain::IngestOptions();
+    options.queue_capacity = 0;
+    CHECK(rejects(options));
+    options = terrain::IngestOptions();
+    options.commit_interval = std::chrono::microseconds(0);
+    CHECK(rejects(options));
+    CHECK(!rejects(terrain::IngestOptions()));
+}
+
+}  // namespace
+
+int main() {
+    test_ingest();
+    return terrain_test::test_exit_code("ingest_test");
+}
@@ -0,0 +1,242 @@
+// Instrumented trees: the counters match the structure they describe, the
+// hooks live only at the root, and recorded traces are well-formed JSON.
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "terrain/quadtree.h"
+#include "test_support.h"
+
+namespace {
+
+typedef terrain::Quadtree<terrain::InstrumentedPolicy> Tree;
+
+// Just enough of a JSON parser to tell whether a document is well-formed.
+class JsonChecker {
+public:
+    explicit JsonChecker(const std::string& text_) : text(text_), pos(0) {}
+    bool valid() {
+        bool ok = value();
+        space();
+        return ok && pos == text.size();
+    }
+private:
+    const std::string& text;
+    std::size_t pos;
+
+    void space() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+            pos++;
+        }
+    }
+    bool eat(char c) {
+        space();
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+    bool value() {
+        space();
+        if (pos >= text.size()) {
+            return false;
+        }
+        char c = text[pos];
+        if (c == '{') {
+            return object();
+        }
+        if (c == '[') {
+            return array();
+        }
+        if (c == '"') {
+            return string();
+        }
+        if (text.compare(pos, 4, "true") == 0 || text.compare(pos, 4, "null") == 0) {
+            pos += 4;
+            return true;
+        }
+        if (text.compare(pos, 5, "false") == 0) {
+            pos += 5;
+            return true;
+        }
+        return number();
+    }
+    bool object() {
+        pos++;
+        if (eat('}')) {
+            return true;
+        }
+        do {
+            space();
+            if (!string() || !eat(':') || !value()) {
+                return false;
+            }
+        } while (eat(','));
+        return eat('}');
+    }
+    bool array() {
+        pos++;
+        if (eat(']')) {
+            return true;
+        }
+        do {
+            if (!value()) {
+                return false;
+            }
+        } while (eat(','));
+        return eat(']');
+    }
+    bool string() {
+        if (pos >= text.size() || text[pos] != '"') {
+            return false;
+        }
+        for (pos++; pos < text.size(); pos++) {
+            if (text[pos] == '\\') {
+                pos++;
+            } else if (text[pos] == '"') {
+                pos++;
+                return true;
+            } else if (static_cast<unsigned char>(text[pos]) < 0x20) {
+                return false;
+            }
+        }
+        return false;
+    }
+    bool digits() {
+        std::size_t start = pos;
+        while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+            pos++;
+        }
+        return pos > start;
+    }
+    bool number() {
+        if (pos < text.size() && text[pos] == '-') {
+            pos++;
+        }
+        if (!digits()) {
+            return false;
+        }
+        if (pos < text.size() && text[pos] == '.') {
+            pos++;
+            if (!digits()) {
+                return false;
+            }
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            pos++;
+            if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+                pos++;
+            }
+            return digits();
+        }
+        return true;
+    }
+};
+
+void test_hooks_at_root_only() {
+    // One handle per node instead of a whole counter block.
+    CHECK(sizeof(Tree) <= sizeof(terrain::Quadtree<>) + sizeof(void*));
+}
+
+void test_first_split() {
+    Tree tree(Tree::Rectangle(0, 0, 100, 100));
+    const auto& c = tree.instrumentation().counters;
+    for (int i = 0; i < 16; i++) {
+        tree.insert(Tree::Point(i, i, 0));
+    }
+    CHECK(c.subdivides == 0 && c.allocated_bytes == 0);
+    tree.insert(Tree::Point(-50, -50, 0));
+    CHECK(c.subdivides == 1);
+    CHECK(c.allocated_bytes == 4 * sizeof(Tree));
+}
+
+void test_counters_match_structure() {
+    Tree tree(Tree::Rectangle(0, 0, 100, 100));
+    const auto& c = tree.instrumentation().counters;
+    terrain_test::fill(tree, 1);
+    // A max-depth cell keeps whatever lands in it, so these spill to the heap.
+    for (int i = 0; i < 1000; i++) {
+        CHECK(tree.insert(Tree::Point(1 + 1e-6 * i, 1, 0)));
+    }
+    auto report = tree.memory_report();
+    CHECK(report.spilled_nodes > 0);
+    CHECK(c.subdivides == (report.nodes - 1) / 4);
+    CHECK(c.allocated_bytes == c.subdivides * 4 * sizeof(Tree) + report.heap_bytes);
+
+    tree.compress();
+    auto compressed = tree.memory_report();
+    CHECK(compressed.nodes < report.nodes);
+    CHECK(c.compress_merges == (report.nodes - compressed.nodes) / 4);
+
+    // A query over the whole tree visits every node and tests every point.
+    tree.instrumentation().reset();
+    std::vector<Tree::Point> found;
+    tree.query(Tree::Rectangle(0, 0, 100, 100), found);
+    CHECK(found.size() == tree.size());
+    CHECK(c.nodes_visited == compressed.nodes);
+    CHECK(c.leaves_scanned == compressed.leaves);
+    CHECK(c.points_tested == tree.size() && c.points_returned == tree.size());
+
+    // count() stops at the root once the range covers it.
+    tree.instrumentation().reset();
+    CHECK(tree.count(Tree::Rectangle(0, 0, 200, 200)) == tree.size());
+    CHECK(c.nodes_visited == 1 && c.points_tested == 0);
+
+    // Nothing is visited for a range outside the tree.
+    tree.instrumentation().reset();
+    found.clear();
+    tree.query(Tree::Rectangle(500, 500, 10, 10), found);
+    CHECK(found.empty() && c.nodes_visited == 0);
+}
+
+void test_trace() {
+    Tree tree(Tree::Rectangle(0, 0, 100, 100));
+    terrain_test::fill(tree, 2);
+    terrain::TraceRecorder recorder;
+    tree.instrumentation().trace = &recorder;
+    std::vector<Tree::Point> found;
+    tree.query(Tree::Rectangle(10, -20, 5, 7.5), found);
+    tree.count(Tree::Rectangle(0, 0, 30, 30));
+    tree.intersect(Tree::Rectangle(-40, 40, 1e-3, 2));
+    tree.line_of_sight(Tree::Point(30, -10, 50), Tree::Point(-10, 50, 50));
+    tree.compress();
+    tree.instrumentation().trace = nullptr;
+    tree.count(Tree::Rectangle(0, 0, 30, 30));
+
+    const auto& spans = recorder.spans();
+    CHECK(spans.size() == 5);
+    if (spans.size() == 5) {
+        CHECK(spans[0].name == "query" && spans[0].cost.points_returned == found.size());
+        CHECK(spans[1].name == "count" && spans[2].name == "intersect" && spans[4].name == "compress");
+        // Spans carry the centre and half-extent of what they covered.
+        const auto& sight = spans[3];
+        CHECK(sight.name == "line_of_sight");
+        CHECK(sight.x == 10 && sight.y == 20 && sight.width == 20 && sight.height == 30);
+        for (const auto& s : spans) {
+            CHECK(s.duration_us >= 0 && s.width >= 0 && s.height >= 0);
+        }
+    }
+    CHECK(JsonChecker(recorder.to_chrome_trace()).valid());
+    CHECK(JsonChecker(recorder.to_json()).valid());
+    CHECK(recorder.to_chrome_trace().find("\"traceEvents\":[{") != std::string::npos);
+    CHECK(JsonChecker(tree.instrumentation().counters.to_json()).valid());
+
+    std::string bad = "{\"traceEvents\":[{\"ts\":nan}]}";
+    CHECK(!JsonChecker(bad).valid());
+    terrain::TraceRecorder empty;
+    CHECK(JsonChecker(empty.to_chrome_trace()).valid());
+}
+
+}  // namespace
+
+int main() {
+    test_hooks_at_root_only();
+    test_first_split();
+    test_counters_match_structure();
+    test_trace();
+    return terrain_test::test_exit_code("instrumentation_test");
+}
@@ -0,0 +1,63 @@
+// spatial_join checked against every pair of points.
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "terrain/join.h"
+#include "terrain/quadtree.h"
+#include "test_support.h"
+
+namespace {
+
+// spatial_join against every pair of points.
+void test_join() {
+    typedef terrain::Quadtree<> Tree;
+    Tree a(terrain::Rectangle(0, 0, 100, 100)), b(terrain::Rectangle(10, 0, 100, 100));
+    std::mt19937 rng(12);
+    std::uniform_real_distribution<double> coord(-100, 100);
+    std::vector<terrain::Point> pa, pb;
+    for (int i = 0; i < 3000; i++) {
+        terrain::Point p(coord(rng), coord(rng), 0), q(coord(rng) + 10, coord(rng), 1);
+        if (a.insert(p)) {
+            pa.push_back(p);
+        }
+        if (b.insert(q)) {
+            pb.push_back(q);
+        }
+    }
+    terrain::JoinOptions options;
+    options.tolerance = 2.0;
+    options.threads = 2;
+    std::size_t expected = 0;
+    for (auto& p : pa) {
+        for (auto& q : pb) {
+            expected += (q.x - p.x) * (q.x - p.x) + (q.y - p.y) * (q.y - p.y) <= 4.0;
+        }
+    }
+    auto result = terrain::spatial_join(a, b, options);
+    CHECK(result.matches == expected);
+    CHECK(result.pairs.size() == expected);
+    std::size_t by_region = 0;
+    for (auto& r : result.regions) {
+        by_region += r.matches;
+    }
+    CHECK(by_region == expected);
+    for (int depth : {-1, 13, 31, 40}) {
+        options.region_depth = depth;
+        bool thrown = false;
+        try {
+            terrain::spatial_join(a, b, options);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_join();
+    return terrain_test::test_exit_code("join_test");
+}
@@ -0,0 +1,123 @@
+// Serialized layouts: queries match the tree they were written from, and
+// damaged files are refused at load instead of crashing a later query.
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "terrain/layout.h"
+#include "terrain/quadtree.h"
+#include "test_support.h"
+
+namespace {
+
+typedef terrain::Quadtree<> Tree;
+
+std::string temp_path(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("terrain_layout_test_" + name + ".layout")).string();
+}
+
+void build(Tree& tree) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> coord(-100, 100), z(-50, 50);
+    for (int i = 0; i < 20000; i++) {
+        tree.insert(Tree::Point(coord(rng), coord(rng), z(rng)));
+    }
+}
+
+void test_round_trip() {
+    Tree tree(Tree::Rectangle(0, 0, 100, 100));
+    build(tree);
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<double> coord(-110, 110), half(0, 30);
+    for (terrain::NodeOrder order : {terrain::NodeOrder::kDepthFirst, terrain::NodeOrder::kZOrder, terrain::NodeOrder::kHilbert}) {
+        std::string path = temp_path("round_trip");
+        CHECK(terrain::write_layout(tree, path, order));
+        terrain::MappedLayout layout(path);
+        CHECK(layout.order() == order);
+        CHECK(layout.point_count() == tree.size());
+        for (int i = 0; i < 200; i++) {
+            Tree::Rectangle range(coord(rng), coord(rng), half(rng), half(rng));
+            std::vector<Tree::Point> expected;
+            std::vector<terrain::MappedLayout::Point> found;
+            tree.query(range, expected);
+            layout.query(terrain::MappedLayout::Rectangle(range.x, range.y, range.width, range.height), found);
+            CHECK(terrain_test::same_points(found, expected));
+        }
+        std::filesystem::remove(path);
+    }
+}
+
+// Writes a valid layout, lets damage() edit its bytes and checks that loading
+// the result throws.
+void check_rejected(const std::string& name, const std::function<void(std::vector<char>&, const terrain::LayoutHeader&)>& damage) {
+    Tree tree(Tree::Rectangle(0, 0, 100, 100));
+    build(tree);
+    std::string path = temp_path(name);
+    CHECK(terrain::write_layout(tree, path, terrain::NodeOrder::kHilbert));
+    std::vector<char> bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    terrain::LayoutHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    damage(bytes, header);
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+    bool thrown = false;
+    try {
+        terrain::MappedLayout layout(path);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    if (!thrown) {
+        std::printf("layout damage '%s' was accepted\n", name.c_str());
+    }
+    CHECK(thrown);
+    std::filesystem::remove(path);
+}
+
+terrain::LayoutNode& node_at(std::vector<char>& bytes, const terrain::LayoutHeader& header, std::uint64_t i) {
+    return *reinterpret_cast<terrain::LayoutNode*>(bytes.data() + header.nodes_offset + i * sizeof(terrain::LayoutNode));
+}
+
+void test_corruption() {
+    check_rejected("magic", [](std::vector<char>& bytes, const terrain::LayoutHeader&) { bytes[0] = 'X'; });
+    check_rejected("truncated", [](std::vector<char>& bytes, const terrain::LayoutHeader& h) { bytes.resize(h.points_offset + 8); });
+    check_rejected("node_count", [](std::vector<char>& bytes, const terrain::LayoutHeader& h) {
+        terrain::LayoutHeader bad = h;
+        bad.node_count = ~std::uint64_t(0) / 2;
+        std::memcpy(bytes.data(), &bad, sizeof(bad));
+    });
+    check_rejected("child_index", [](std::vector<char>& bytes, const terrain::LayoutHeader& h) {
+        node_at(bytes, h, h.root).children[2] = static_cast<std::uint32_t>(h.node_count);
+    });
+    check_rejected("point_range", [](std::vector<char>& bytes, const terrain::LayoutHeader& h) {
+        node_at(bytes, h, h.root).first_point = h.point_count - 1;
+        node_at(bytes, h, h.root).point_count = 2;
+    });
+    check_rejected("cycle", [](std::vector<char>& bytes, const terrain::LayoutHeader& h) {
+        std::uint32_t child = node_at(bytes, h, h.root).children[0];
+        node_at(bytes, h, child).children[0] = static_cast<std::uint32_t>(h.root);
+    });
+    check_rejected("shared_child", [](std::vector<char>& bytes, const terrain::LayoutHeader& h) {
+        terrain::LayoutNode& root = node_at(bytes, h, h.root);
+        root.children[1] = root.children[0];
+    });
+}
+
+}  // namespace
+
+int main() {
+    test_round_trip();
+    test_corruption();
+    return terrain_test::test_exit_code("layout_test");
+}
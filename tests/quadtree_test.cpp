@@ -0,0 +1,204 @@
+// Quadtree queries checked against a brute-force scan of the inserted points.
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "terrain/quadtree.h"
+#include "terrain/rle.h"
+#include "test_support.h"
+
+namespace {
+
+using terrain_test::fill;
+using terrain_test::same_points;
+
+template <typename Tree>
+std::vector<typename Tree::Point> brute_query(const std::vector<typename Tree::Point>& all, const typename Tree::Rectangle& range) {
+    std::vector<typename Tree::Point> out;
+    for (auto& p : all) {
+        if (range.contains(p)) {
+            out.push_back(p);
+        }
+    }
+    return out;
+}
+
+template <typename Tree>
+std::vector<typename Tree::Rectangle> ranges(unsigned seed) {
+    typedef typename Tree::Rectangle Rectangle;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> coord(-110, 110), half(0, 40);
+    std::uniform_int_distribution<int> grid(-20, 20), cells(0, 8);
+    std::vector<Rectangle> out;
+    for (int i = 0; i < 300; i++) {
+        out.push_back(Rectangle(coord(rng), coord(rng), half(rng), half(rng)));
+        // Edges on the point grid.
+        double w = 2.5 * cells(rng), h = 2.5 * cells(rng);
+        out.push_back(Rectangle(5.0 * grid(rng) + w, 5.0 * grid(rng) + h, w, h));
+    }
+    out.push_back(Rectangle(0, 0, 100, 100));
+    out.push_back(Rectangle(0, 0, 1000, 1000));
+    return out;
+}
+
+template <typename Tree>
+void check_queries(const Tree& tree, const std::vector<typename Tree::Point>& all, unsigned seed) {
+    for (auto& range : ranges<Tree>(seed)) {
+        auto expected = brute_query<Tree>(all, range);
+        std::vector<typename Tree::Point> found;
+        tree.query(range, found);
+        CHECK(same_points(found, expected));
+        CHECK(same_points(tree.intersect(range), expected));
+        CHECK(tree.count(range) == expected.size());
+        CHECK(tree.any(range) == !expected.empty());
+    }
+}
+
+template <typename Tree>
+void test_queries(double tolerance) {
+    Tree tree(typename Tree::Rectangle(0, 0, 100, 100), tolerance);
+    auto all = fill(tree, 1);
+    check_queries(tree, all, 2);
+}
+
+// compress() must not change what any query returns, and the tree must keep
+// accepting inserts afterwards.
+template <typename Tree>
+void test_compress_round_trip(double tolerance) {
+    typedef typename Tree::Point Point;
+    Tree tree(typename Tree::Rectangle(0, 0, 100, 100), tolerance);
+    auto all = fill(tree, 3);
+    tree.compress();
+    CHECK(tree.size() == all.size());
+    check_queries(tree, all, 4);
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<double> coord(-100, 100);
+    for (int i = 0; i < 2000; i++) {
+        Point p(coord(rng), coord(rng), 0);
+        CHECK(tree.insert(p));
+        all.push_back(p);
+    }
+    check_queries(tree, all, 7);
+    tree.compress();
+    check_queries(tree, all, 8);
+}
+
+// On flat ground compress() must actually fold quadrants back into their
+// parents, and the plane-fit rule must need far fewer nodes than the count rule.
+template <typename Tree>
+std::pair<std::size_t, std::size_t> flat_nodes(double tolerance) {
+    typedef typename Tree::Point Point;
+    Tree tree(typename Tree::Rectangle(0, 0, 100, 100), tolerance);
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> coord(-100, 100);
+    std::vector<Point> all;
+    for (int i = 0; i < 20000; i++) {
+        Point p(coord(rng), coord(rng), 5);
+        CHECK(tree.insert(p));
+        all.push_back(p);
+    }
+    std::size_t before = tree.memory_report().nodes;
+    tree.compress();
+    std::size_t after = tree.memory_report().nodes;
+    CHECK(after <= before && (before - after) % 4 == 0);
+    check_queries(tree, all, 12);
+    return {before, after};
+}
+
+void test_compress_flat() {
+    auto count = flat_nodes<terrain::Quadtree<>>(0);
+    auto adaptive = flat_nodes<terrain::Quadtree<terrain::AdaptivePolicy>>(1.0);
+    CHECK(count.second < count.first);
+    CHECK(adaptive.second * 2 < count.second);
+}
+
+// The report's split must add up to what the nodes and their spills occupy,
+// and shrink_to_fit() must only give back slack.
+template <typename Tree>
+void check_report(const Tree& tree) {
+    auto report = tree.memory_report();
+    CHECK(report.node_size == sizeof(Tree));
+    CHECK(report.points == tree.size());
+    CHECK(report.payload_bytes == tree.size() * sizeof(typename Tree::Point));
+    CHECK(report.total_bytes() == report.nodes * sizeof(Tree) + report.heap_bytes);
+    CHECK(report.spill_slack_bytes <= report.slack_bytes);
+    std::size_t by_depth = 0, by_fill = 0;
+    for (std::size_t n : report.nodes_by_depth) {
+        by_depth += n;
+    }
+    for (std::size_t n : report.leaf_fill) {
+        by_fill += n;
+    }
+    CHECK(by_depth == report.nodes);
+    CHECK(by_fill == report.leaves);
+}
+
+template <typename Tree>
+void test_memory_report(double tolerance) {
+    typedef typename Tree::Point Point;
+    Tree tree(typename Tree::Rectangle(0, 0, 100, 100), tolerance);
+    auto all = fill(tree, 13);
+    // A max-depth cell keeps whatever lands in it, so these spill to the heap.
+    for (int i = 0; i < 1000; i++) {
+        Point p(1 + 1e-6 * i, 1, i % 7);
+        CHECK(tree.insert(p));
+        all.push_back(p);
+    }
+    check_report(tree);
+    tree.compress();
+    check_report(tree);
+    auto before = tree.memory_report();
+    CHECK(before.spilled_nodes > 0 && before.spill_slack_bytes > 0);
+    std::size_t freed = tree.shrink_to_fit();
+    check_report(tree);
+    auto after = tree.memory_report();
+    CHECK(freed == before.total_bytes() - after.total_bytes());
+    CHECK(after.slack_bytes < before.slack_bytes);
+    CHECK(after.spill_slack_bytes == 0);
+    CHECK(after.payload_bytes == before.payload_bytes && after.structure_bytes == before.structure_bytes);
+    check_queries(tree, all, 14);
+
+    // Quadrants holding nothing are deleted outright.
+    Tree empty(typename Tree::Rectangle(0, 0, 100, 100), tolerance);
+    empty.subdivide();
+    CHECK(empty.memory_report().nodes == 5);
+    CHECK(empty.shrink_to_fit() == 4 * sizeof(Tree));
+    CHECK(empty.memory_report().nodes == 1);
+    check_report(empty);
+}
+
+// A second subdivide() must keep the existing quadrants and their points.
+void test_subdivide_twice() {
+    terrain::Quadtree<> tree(terrain::Rectangle(0, 0, 100, 100));
+    tree.subdivide();
+    const terrain::Quadtree<>* nw = tree.child(0);
+    auto all = fill(tree, 9);
+    tree.subdivide();
+    CHECK(tree.child(0) == nw);
+    check_queries(tree, all, 10);
+}
+
+void test_rle() {
+    std::vector<int> values{3, 3, 3, 1, 2, 2};
+    terrain::compressRLE(values);
+    CHECK((values == std::vector<int>{3, 3, 1, 1, 2, 2}));
+    std::vector<int> empty;
+    terrain::compressRLE(empty);
+    CHECK(empty.empty());
+}
+
+}  // namespace
+
+int main() {
+    test_queries<terrain::Quadtree<>>(0);
+    test_queries<terrain::Quadtree<terrain::AdaptivePolicy>>(1.0);
+    test_queries<terrain::Quadtree<terrain::InstrumentedPolicy>>(0);
+    test_compress_round_trip<terrain::Quadtree<>>(0);
+    test_compress_round_trip<terrain::Quadtree<terrain::AdaptivePolicy>>(1.0);
+    test_compress_flat();
+    test_memory_report<terrain::Quadtree<>>(0);
+    test_memory_report<terrain::Quadtree<terrain::AdaptivePolicy>>(1.0);
+    test_subdivide_twice();
+    test_rle();
+    return terrain_test::test_exit_code("quadtree_test");
+}
@@ -0,0 +1,118 @@
+// QueryCache results must match an uncached query exactly, including ranges
+// whose edges sit on the cache's snapping grid, and stay exact as the tree
+// changes through the cache.
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "terrain/quadtree.h"
+#include "terrain/query_cache.h"
+#include "test_support.h"
+
+namespace {
+
+typedef terrain::Quadtree<> Tree;
+
+// Points on a 0.1 grid, so ranges with grid edges have points on their
+// boundary.
+void build(Tree& tree, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> cell(-1000, 1000);
+    std::uniform_real_distribution<double> z(-50, 50);
+    for (int i = 0; i < 40000; i++) {
+        tree.insert(Tree::Point(cell(rng) * 0.1, cell(rng) * 0.1, z(rng)));
+    }
+}
+
+Tree::Rectangle from_edges(double x0, double y0, double x1, double y1) {
+    return Tree::Rectangle((x0 + x1) / 2, (y0 + y1) / 2, (x1 - x0) / 2, (y1 - y0) / 2);
+}
+
+bool cached_matches(terrain::QueryCache<Tree>& cache, const Tree& tree, const Tree::Rectangle& range) {
+    std::vector<Tree::Point> cached, direct;
+    cache.query(range, cached);
+    tree.query(range, direct);
+    return terrain_test::same_points(cached, direct);
+}
+
+void test_edge_aligned(double quantum) {
+    Tree tree(Tree::Rectangle(0, 0, 100, 100));
+    build(tree, 1);
+    terrain::QueryCacheOptions options;
+    options.quantum = quantum;
+    terrain::QueryCache<Tree> cache(tree, options);
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int> edge(-900, 900), span(0, 60);
+    int wrong = 0;
+    for (int i = 0; i < 20000; i++) {
+        double x0 = edge(rng) * 0.1, y0 = edge(rng) * 0.1;
+        Tree::Rectangle range = from_edges(x0, y0, x0 + span(rng) * 0.1, y0 + span(rng) * 0.1);
+        // Twice, so both the miss and the hit path are checked.
+        wrong += !cached_matches(cache, tree, range);
+        wrong += !cached_matches(cache, tree, range);
+    }
+    CHECK(wrong == 0);
+    CHECK(cached_matches(cache, tree, from_edges(9, 9, 10.1, 10.1)));
+    CHECK(cache.stats().hits > 0);
+}
+
+void test_mutations() {
+    Tree tree(Tree::Rectangle(0, 0, 100, 100));
+    build(tree, 3);
+    terrain::QueryCacheOptions options;
+    options.quantum = 0.5;
+    terrain::QueryCache<Tree> cache(tree, options);
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<double> coord(-90, 90), half(0, 5), wide(0, 80);
+    std::uniform_int_distribution<int> grid(-180, 180);
+    std::vector<Tree::Rectangle> ranges;
+    for (int i = 0; i < 200; i++) {
+        ranges.push_back(Tree::Rectangle(coord(rng), coord(rng), half(rng), half(rng)));
+    }
+    // Windows far wider than a cell, filed in coarse buckets.
+    for (int i = 0; i < 10; i++) {
+        ranges.push_back(Tree::Rectangle(coord(rng), coord(rng), wide(rng), half(rng)));
+    }
+    ranges.push_back(Tree::Rectangle(0, 0, 100, 100));
+    for (int round = 0; round < 5; round++) {
+        for (auto& range : ranges) {
+            CHECK(cached_matches(cache, tree, range));
+        }
+        for (int i = 0; i < 500; i++) {
+            cache.insert(Tree::Point(coord(rng), coord(rng), 0));
+            // On cell edges, where cached windows end.
+            cache.insert(Tree::Point(grid(rng) * 0.5, grid(rng) * 0.5, 0));
+        }
+        if (round % 2 == 1) {
+            cache.compress();
+        }
+    }
+}
+
+void test_bad_quantum() {
+    Tree tree(Tree::Rectangle(0, 0, 100, 100));
+    for (double quantum : {0.0, -1.0, std::nan(""), std::numeric_limits<double>::infinity()}) {
+        terrain::QueryCacheOptions options;
+        options.quantum = quantum;
+        bool threw = false;
+        try {
+            terrain::QueryCache<Tree> cache(tree, options);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_edge_aligned(0.1);
+    test_edge_aligned(0.3);
+    test_edge_aligned(1.0);
+    test_mutations();
+    test_bad_quantum();
+    return terrain_test::test_exit_code("query_cache_test");
+}
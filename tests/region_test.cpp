@@ -0,0 +1,49 @@
+// Polygon and corridor queries checked against the regions' own contains().
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "terrain/quadtree.h"
+#include "terrain/region.h"
+#include "test_support.h"
+
+namespace {
+
+// Polygon and corridor queries against their own contains().
+void test_regions() {
+    typedef terrain::Quadtree<> Tree;
+    Tree tree(terrain::Rectangle(0, 0, 100, 100));
+    auto all = terrain_test::fill(tree, 10);
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> coord(-100, 100), radius(0, 10);
+    for (int i = 0; i < 100; i++) {
+        std::vector<terrain::Polygon::Vertex> ring;
+        double cx = coord(rng) / 2, cy = coord(rng) / 2;
+        for (int k = 0; k < 7; k++) {
+            double a = k * 2 * M_PI / 7, r = 5 + radius(rng) * 4;
+            ring.push_back({cx + r * std::cos(a), cy + r * std::sin(a)});
+        }
+        terrain::Polygon polygon(ring);
+        terrain::Corridor corridor({{coord(rng), coord(rng)}, {coord(rng), coord(rng)}, {coord(rng), coord(rng)}}, radius(rng));
+        std::vector<terrain::Point> in_polygon, in_corridor, expected_polygon, expected_corridor;
+        tree.query(polygon, in_polygon);
+        tree.query(corridor, in_corridor);
+        for (auto& p : all) {
+            if (polygon.contains(p.x, p.y)) {
+                expected_polygon.push_back(p);
+            }
+            if (corridor.contains(p.x, p.y)) {
+                expected_corridor.push_back(p);
+            }
+        }
+        CHECK(terrain_test::same_points(in_polygon, expected_polygon));
+        CHECK(terrain_test::same_points(in_corridor, expected_corridor));
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_regions();
+    return terrain_test::test_exit_code("region_test");
+}
@@ -0,0 +1,109 @@
+// Line of sight and viewshed checked against a per-sample test of every
+// stored point.
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "terrain/quadtree.h"
+#include "terrain/sight_line.h"
+#include "terrain/visibility.h"
+#include "test_support.h"
+
+namespace {
+
+typedef terrain::Quadtree<> Tree;
+
+// Rolling ground, so that some sight lines clear it and some do not.
+std::vector<terrain::Point> hills(Tree& tree, unsigned seed, int n) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> coord(-100, 100);
+    std::vector<terrain::Point> all;
+    for (int i = 0; i < n; i++) {
+        double x = coord(rng), y = coord(rng);
+        terrain::Point p(x, y, 10 * std::sin(x / 9) * std::cos(y / 13));
+        tree.insert(p);
+        all.push_back(p);
+    }
+    return all;
+}
+
+bool clear_by_scan(const std::vector<terrain::Point>& all, const terrain::SightLine& line) {
+    if (line.degenerate()) {
+        return true;
+    }
+    for (auto& p : all) {
+        if (line.blocks(p.x, p.y, p.elevation)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_line_of_sight() {
+    Tree tree(terrain::Rectangle(0, 0, 100, 100));
+    auto all = hills(tree, 9, 20000);
+    std::mt19937 rng(10);
+    std::uniform_int_distribution<std::size_t> pick(0, all.size() - 1);
+    for (int i = 0; i < 500; i++) {
+        const terrain::Point& a = all[pick(rng)];
+        const terrain::Point& b = all[pick(rng)];
+        double radius = (i % 3) * 0.5;
+        terrain::SightLine line(a.x, a.y, a.elevation + 2, b.x, b.y, b.elevation + 1, radius);
+        CHECK(tree.line_of_sight(a, b, 2, 1, radius) == clear_by_scan(all, line));
+    }
+}
+
+// Each cell recomputed by hand: its samples found by scanning, its ground the
+// mean the tree's query gives, and its visibility by scanning every sample.
+// Threads only split rows, so any thread count gives the same grid.
+void test_viewshed() {
+    Tree tree(terrain::Rectangle(0, 0, 100, 100));
+    auto all = hills(tree, 11, 4000);
+    terrain::ViewshedGrid grid{-95, -95, 10, 20, 20};
+    const double oh = 5, th = 1, radius = 0.5;
+    for (int o = 0; o < 3; o++) {
+        const terrain::Point& observer = all[o * 997];
+        auto single = terrain::viewshed(tree, observer, grid, oh, th, radius, 1);
+        auto several = terrain::viewshed(tree, observer, grid, oh, th, radius, 4);
+        CHECK(single == several);
+        int visible = 0, hidden = 0;
+        for (int row = 0; row < grid.ny; row++) {
+            for (int col = 0; col < grid.nx; col++) {
+                double cx = grid.x0 + col * grid.cell, cy = grid.y0 + row * grid.cell;
+                terrain::Rectangle cell(cx, cy, grid.cell / 2, grid.cell / 2);
+                std::vector<terrain::Point> inside, found;
+                for (auto& p : all) {
+                    if (cell.contains(p)) {
+                        inside.push_back(p);
+                    }
+                }
+                tree.query(cell, found);
+                CHECK(terrain_test::same_points(inside, found));
+                std::int8_t expected = terrain::kNoData;
+                if (!found.empty()) {
+                    double ground = 0;
+                    for (auto& p : found) {
+                        ground += p.elevation;
+                    }
+                    ground /= found.size();
+                    terrain::SightLine line(observer.x, observer.y, observer.elevation + oh, cx, cy, ground + th, radius);
+                    expected = clear_by_scan(all, line) ? terrain::kVisible : terrain::kHidden;
+                }
+                CHECK(single[static_cast<std::size_t>(row) * grid.nx + col] == expected);
+                visible += expected == terrain::kVisible;
+                hidden += expected == terrain::kHidden;
+            }
+        }
+        CHECK(visible > 0);
+        CHECK(hidden > 0);
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_line_of_sight();
+    test_viewshed();
+    return terrain_test::test_exit_code("sight_line_test");
+}
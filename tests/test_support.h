@@ -0,0 +1,88 @@
+#ifndef TERRAIN_TEST_SUPPORT_H
+#define TERRAIN_TEST_SUPPORT_H
+
+// Minimal check macros for the test executables: a failed CHECK prints where
+// and carries on, and test_exit_code() turns the tally into main's result.
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#define CHECK(cond)                                                                \
+    do {                                                                           \
+        if (!(cond)) {                                                             \
+            std::printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);   \
+            terrain_test::failures()++;                                            \
+        }                                                                          \
+    } while (0)
+
+namespace terrain_test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline int test_exit_code(const char* name) {
+    if (failures() == 0) {
+        std::printf("%s: all checks passed\n", name);
+        return 0;
+    }
+    std::printf("%s: %d check(s) failed\n", name, failures());
+    return 1;
+}
+
+// Sorts points so results from different traversals compare equal.
+template <typename Point>
+std::vector<Point> sorted(std::vector<Point> pts) {
+    std::sort(pts.begin(), pts.end(), [](const Point& a, const Point& b) {
+        return std::tie(a.x, a.y, a.elevation) < std::tie(b.x, b.y, b.elevation);
+    });
+    return pts;
+}
+
+template <typename Point>
+bool same_points(const std::vector<Point>& a, const std::vector<Point>& b) {
+    std::vector<Point> sa = sorted(a), sb = sorted(b);
+    if (sa.size() != sb.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < sa.size(); i++) {
+        if (sa[i].x != sb[i].x || sa[i].y != sb[i].y || sa[i].elevation != sb[i].elevation) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Fills a tree over [-100, 100]^2 with uniform samples plus a grid of integer
+// positions, so that ranges with integer edges land exactly on points, and
+// returns everything it inserted.
+template <typename Tree>
+std::vector<typename Tree::Point> fill(Tree& tree, unsigned seed) {
+    typedef typename Tree::Point Point;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> coord(-100, 100), z(-50, 50);
+    std::vector<Point> all;
+    for (int i = 0; i < 20000; i++) {
+        Point p(coord(rng), coord(rng), z(rng));
+        if (tree.insert(p)) {
+            all.push_back(p);
+        }
+    }
+    for (int x = -100; x <= 100; x += 5) {
+        for (int y = -100; y <= 100; y += 5) {
+            Point p(x, y, z(rng));
+            CHECK(tree.insert(p));
+            all.push_back(p);
+        }
+    }
+    CHECK(!tree.insert(Point(150, 0, 0)));
+    CHECK(tree.size() == all.size());
+    return all;
+}
+
+}  // namespace terrain_test
+
+#endif
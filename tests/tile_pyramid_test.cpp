@@ -0,0 +1,247 @@
+// Tile pyramids: the codecs round-trip, every exported tile matches what a
+// query() of its bounds says it should hold, and a throwing sink is counted
+// as a failed write instead of taking the process down.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "terrain/quadtree.h"
+#include "terrain/tile_pyramid.h"
+#include "test_support.h"
+
+namespace {
+
+typedef terrain::Quadtree<> Tree;
+typedef std::tuple<int, int, int> TileId;
+
+void check_round_trip(const std::vector<std::int32_t>& heights, int tile_size) {
+    for (terrain::TileEncoding encoding : {terrain::TileEncoding::kRaw, terrain::TileEncoding::kRLE}) {
+        terrain::TileCodec codec(tile_size, encoding);
+        CHECK(codec.decode(codec.encode(heights)) == heights);
+        CHECK(terrain::decode_tile(terrain::encode_tile(heights, tile_size, encoding), tile_size, encoding) == heights);
+    }
+}
+
+void test_codec() {
+    const int T = 8;
+    std::vector<std::int32_t> empty(T * T, terrain::kTileNoData);
+    check_round_trip(empty, T);
+    // An empty tile is a single run.
+    CHECK(terrain::encode_tile(empty, T, terrain::TileEncoding::kRLE).size() < 8);
+
+    std::vector<std::int32_t> single = empty;
+    single[3 * T + 5] = -7;
+    check_round_trip(single, T);
+
+    // Values that step down, cross zero and hit both ends of the range.
+    std::vector<std::int32_t> falling(T * T);
+    for (int i = 0; i < T * T; i++) {
+        falling[i] = 100 - 7 * i;
+    }
+    falling[0] = std::numeric_limits<std::int32_t>::max();
+    falling[1] = terrain::kTileNoData + 1;
+    check_round_trip(falling, T);
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> runs(0, 3), value(-1000, 1000);
+    std::vector<std::int32_t> mixed(T * T);
+    for (auto& h : mixed) {
+        h = runs(rng) == 0 ? terrain::kTileNoData : value(rng) / 100;
+    }
+    check_round_trip(mixed, T);
+    check_round_trip(std::vector<std::int32_t>(2 * 2, -1), 2);
+
+    terrain::TileCodec rle(T, terrain::TileEncoding::kRLE);
+    std::string bytes = rle.encode(mixed);
+    bool threw = false;
+    try {
+        rle.decode(bytes.substr(0, bytes.size() - 1));
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    threw = false;
+    try {
+        terrain::TileCodec(T, terrain::TileEncoding::kRaw).decode(std::string(7, '\0'));
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+// Integer elevations keep every per-pixel sum exact, so the expected means
+// do not depend on the order points are added in; the 5-unit grid puts
+// points exactly on tile and pixel edges.
+std::vector<Tree::Point> build(Tree& tree) {
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<double> coord(-100, 100);
+    std::uniform_int_distribution<int> z(-50, 50);
+    std::vector<Tree::Point> all;
+    // Grid first, so internal nodes hold points on their own split lines.
+    for (int x = -100; x <= 100; x += 5) {
+        for (int y = -100; y <= 100; y += 5) {
+            all.emplace_back(x, y, z(rng));
+        }
+    }
+    std::shuffle(all.begin(), all.end(), rng);
+    for (int i = 0; i < 20000; i++) {
+        all.emplace_back(coord(rng), coord(rng), z(rng));
+    }
+    // Leave one corner empty so some tiles are never exported.
+    std::vector<Tree::Point> kept;
+    for (auto& p : all) {
+        if ((p.x < 50 || p.y < 50) && tree.insert(p)) {
+            kept.push_back(p);
+        }
+    }
+    return kept;
+}
+
+// Where the exporter puts a point: its tile at every zoom, following the rule
+// that a point on a split line goes west / north, and its pixel in the
+// max-zoom tile.
+struct Placement {
+    std::vector<std::pair<int, int>> tiles;
+    int px, py;
+};
+
+Placement place(const Tree& tree, const Tree::Point& p, int max_zoom, int T) {
+    const auto& b = tree.bounds();
+    double root_minx = b.x - b.width, root_miny = b.y - b.height;
+    double root_w = 2 * b.width, root_h = 2 * b.height;
+    Placement out;
+    int tx = 0, ty = 0;
+    for (int z = 0;; z++) {
+        out.tiles.emplace_back(tx, ty);
+        double tw = root_w / (1 << z), th = root_h / (1 << z);
+        double minx = root_minx + tx * tw, miny = root_miny + ty * th;
+        if (z == max_zoom) {
+            out.px = std::min(T - 1, std::max(0, static_cast<int>((p.x - minx) / (tw / T))));
+            out.py = std::min(T - 1, std::max(0, static_cast<int>((p.y - miny) / (th / T))));
+            return out;
+        }
+        tx = 2 * tx + (p.x <= minx + tw / 2 ? 0 : 1);
+        ty = 2 * ty + (p.y <= miny + th / 2 ? 0 : 1);
+    }
+}
+
+// Rebuilds tile (z, x, y) from a query() of its bounds, keeping the points
+// the exporter routes to it and averaging them into the pixel their
+// max-zoom pixel downsamples to.
+std::vector<std::int32_t> expected_tile(const Tree& tree, const terrain::TilePyramidOptions& options, int z, int tx, int ty) {
+    const int T = options.tile_size;
+    const auto& b = tree.bounds();
+    double tw = 2 * b.width / (1 << z), th = 2 * b.height / (1 << z);
+    double minx = b.x - b.width + tx * tw, miny = b.y - b.height + ty * th;
+    std::vector<Tree::Point> found;
+    tree.query(Tree::Rectangle(minx + tw / 2, miny + th / 2, tw / 2, th / 2), found);
+    std::vector<double> sum(T * T, 0.0);
+    std::vector<int> count(T * T, 0);
+    int shift = options.max_zoom - z;
+    for (auto& p : found) {
+        Placement at = place(tree, p, options.max_zoom, T);
+        if (at.tiles[z] != std::make_pair(tx, ty)) {
+            continue;
+        }
+        auto [mx, my] = at.tiles[options.max_zoom];
+        int gx = ((mx - (tx << shift)) * T + at.px) >> shift;
+        int gy = ((my - (ty << shift)) * T + at.py) >> shift;
+        sum[gy * T + gx] += p.elevation;
+        count[gy * T + gx]++;
+    }
+    std::vector<std::int32_t> heights(T * T, terrain::kTileNoData);
+    bool any = false;
+    for (int i = 0; i < T * T; i++) {
+        if (count[i] != 0) {
+            heights[i] = static_cast<std::int32_t>(std::round(sum[i] / count[i] / options.vertical_resolution));
+            any = true;
+        }
+    }
+    return any ? heights : std::vector<std::int32_t>();
+}
+
+void test_export_matches_query() {
+    Tree tree(Tree::Rectangle(0, 0, 100, 100));
+    build(tree);
+    for (unsigned threads : {1u, 4u}) {
+        terrain::TilePyramidOptions options;
+        options.max_zoom = 3;
+        options.tile_size = 8;
+        options.vertical_resolution = 0.5;
+        options.threads = threads;
+        options.queue_capacity = 2;
+        std::mutex mutex;
+        std::map<TileId, std::string> tiles;
+        auto stats = terrain::export_tile_pyramid(tree, options, [&](int z, int x, int y, const std::string& bytes) {
+            std::lock_guard<std::mutex> lock(mutex);
+            CHECK(tiles.emplace(TileId(z, x, y), bytes).second);
+            return true;
+        });
+        CHECK(stats.failed_writes == 0);
+        terrain::TileCodec codec(options.tile_size, options.encoding);
+        std::size_t expected_tiles = 0;
+        for (int z = 0; z <= options.max_zoom; z++) {
+            std::size_t at_zoom = 0;
+            for (int x = 0; x < (1 << z); x++) {
+                for (int y = 0; y < (1 << z); y++) {
+                    auto expected = expected_tile(tree, options, z, x, y);
+                    auto it = tiles.find(TileId(z, x, y));
+                    if (expected.empty()) {
+                        CHECK(it == tiles.end());
+                        continue;
+                    }
+                    at_zoom++;
+                    CHECK(it != tiles.end());
+                    if (it != tiles.end()) {
+                        CHECK(codec.decode(it->second) == expected);
+                    }
+                }
+            }
+            CHECK(stats.tiles[z] == at_zoom);
+            expected_tiles += at_zoom;
+        }
+        // The empty corner leaves some max-zoom tiles out.
+        CHECK(expected_tiles < 1 + 4 + 16 + 64);
+        CHECK(tiles.size() == expected_tiles);
+    }
+}
+
+void test_throwing_sink() {
+    Tree tree(Tree::Rectangle(0, 0, 100, 100));
+    build(tree);
+    terrain::TilePyramidOptions options;
+    options.max_zoom = 2;
+    options.tile_size = 4;
+    options.threads = 2;
+    int calls = 0;
+    std::mutex mutex;
+    auto stats = terrain::export_tile_pyramid(tree, options, [&](int z, int, int, const std::string&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        calls++;
+        if (z == 2) {
+            throw std::runtime_error("disk full");
+        }
+        return z != 1;
+    });
+    CHECK(stats.tiles[0] == 1 && stats.tiles[1] == 4);
+    CHECK(stats.failed_writes == stats.tiles[1] + stats.tiles[2]);
+    CHECK(static_cast<std::size_t>(calls) == stats.tiles[0] + stats.tiles[1] + stats.tiles[2]);
+}
+
+}  // namespace
+
+int main() {
+    test_codec();
+    test_export_matches_query();
+    test_throwing_sink();
+    return terrain_test::test_exit_code("tile_pyramid_test");
+}